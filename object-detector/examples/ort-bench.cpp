@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <opencv2/opencv.hpp>
+#include <glib.h>
+#include "src/ortclient.h"
+#include "src/stagestats.h"
+
+/**
+ * End-to-end throughput and latency benchmark of an object detection model.
+ *
+ * Usage: ./ort-bench [options] <path to ONNX model file> <path to label file for model> <input>...
+ * where each input is an image, a directory of images, or a video (whose first
+ * --max-frames frames are decoded). Options:
+ *   --warmup <n>          warm-up detections per configuration (default 10)
+ *   --iterations <n>      measured detections per configuration (default 100)
+ *   --threads <list>      intra-op thread counts to sweep, e.g. 1,2,4 (default 0 = ORT default)
+ *   --opt <list>          optimization levels to sweep: disable, basic, extended, all (default extended)
+ *   --providers <list>    execution providers to sweep: CPU, CUDA, DNNL, XNNPACK, OPENVINO (default CPU)
+ *   --model <name>        detection model: yolov4, yolov8 (default yolov4)
+ *   --input-size <n>      model input size, for models with dynamic input size (default 0 = model's own)
+ *   --max-frames <n>      frames to decode from each video (default 100)
+ *
+ * Every combination of threads, optimization level and provider gets its own
+ * client (model load time is reported separately). Providers that are not
+ * available, and would fall back to CPU, are reported and skipped. Frames are detected one at
+ * a time, cycling through the inputs, and nothing is displayed, so the tool runs
+ * headless. A comparison table of fps and p50/p95/p99 latency of each stage
+ * (in milliseconds) is printed to stdout.
+ */
+
+// Configuration of one benchmark run
+struct BenchConfig {
+  std::string provider_name;
+  GstOrtExecutionProvider provider;
+  std::string opt_name;
+  GstOrtOptimizationLevel opt_level;
+  int threads;
+};
+
+// Splits a comma separated list
+static std::vector<std::string> SplitList(std::string const& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+static bool ParseProvider(std::string const& name, GstOrtExecutionProvider& provider) {
+  if (name == "CPU") {
+    provider = GST_ORT_EXECUTION_PROVIDER_CPU;
+  } else if (name == "CUDA") {
+    provider = GST_ORT_EXECUTION_PROVIDER_CUDA;
+  } else if (name == "DNNL") {
+    provider = GST_ORT_EXECUTION_PROVIDER_DNNL;
+  } else if (name == "XNNPACK") {
+    provider = GST_ORT_EXECUTION_PROVIDER_XNNPACK;
+  } else if (name == "OPENVINO") {
+    provider = GST_ORT_EXECUTION_PROVIDER_OPENVINO;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool ParseDetectionModel(std::string const& name, GstOrtDetectionModel& detection_model) {
+  if (name == "yolov4") {
+    detection_model = GST_ORT_DETECTION_MODEL_YOLOV4;
+  } else if (name == "yolov8") {
+    detection_model = GST_ORT_DETECTION_MODEL_YOLOV8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool ParseOptimizationLevel(std::string const& name, GstOrtOptimizationLevel& opt_level) {
+  if (name == "disable") {
+    opt_level = GST_ORT_OPTIMIZATION_LEVEL_DISABLE_ALL;
+  } else if (name == "basic") {
+    opt_level = GST_ORT_OPTIMIZATION_LEVEL_ENABLE_BASIC;
+  } else if (name == "extended") {
+    opt_level = GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED;
+  } else if (name == "all") {
+    opt_level = GST_ORT_OPTIMIZATION_LEVEL_ENABLE_ALL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Decodes an input into frames (in BGR, as decoded by OpenCV).
+ *
+ * @param path image, directory of images, or video.
+ * @param max_frames maximum number of frames to decode from a video.
+ * @param frames out-param to append decoded frames to.
+ * @return true if at least one frame was decoded.
+ */
+static bool LoadInput(std::string const& path, int max_frames, std::vector<cv::Mat>& frames) {
+  size_t count = frames.size();
+  if (g_file_test(path.c_str(), G_FILE_TEST_IS_DIR)) {
+    GDir *dir = g_dir_open(path.c_str(), 0, NULL);
+    if (!dir) {
+      return false;
+    }
+    std::vector<std::string> entries;
+    const gchar *entry;
+    while ((entry = g_dir_read_name(dir)) != NULL) {
+      entries.push_back(entry);
+    }
+    g_dir_close(dir);
+    // Directory order is arbitrary; keep runs comparable
+    std::sort(entries.begin(), entries.end());
+    for (std::string const& name : entries) {
+      gchar *entry_path = g_build_filename(path.c_str(), name.c_str(), NULL);
+      cv::Mat image = cv::imread(entry_path);
+      g_free(entry_path);
+      if (!image.empty()) {
+        frames.push_back(image);
+      }
+    }
+    return frames.size() > count;
+  }
+  cv::Mat image = cv::imread(path);
+  if (!image.empty()) {
+    frames.push_back(image);
+    return true;
+  }
+  cv::VideoCapture video(path);
+  cv::Mat frame;
+  while ((int) (frames.size() - count) < max_frames && video.read(frame)) {
+    frames.push_back(frame.clone());
+  }
+  return frames.size() > count;
+}
+
+// Formats p50/p95/p99 of a stage
+static std::string FormatStage(StageStats& stats, InferenceStage stage) {
+  StageSummary summary = stats.GetSummary(stage);
+  char text[64];
+  snprintf(text, sizeof(text), "%7.2f %7.2f %7.2f", summary.p50_ms, summary.p95_ms, summary.p99_ms);
+  return text;
+}
+
+int main(int argc, char* argv[]) {
+  int warmup = 10;
+  int iterations = 100;
+  int input_size = 0;
+  int max_frames = 100;
+  std::string model_name = "yolov4";
+  std::vector<std::string> thread_list{"0"};
+  std::vector<std::string> opt_list{"extended"};
+  std::vector<std::string> provider_list{"CPU"};
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--warmup" && has_value) {
+      warmup = atoi(argv[++i]);
+    } else if (arg == "--iterations" && has_value) {
+      iterations = std::max(atoi(argv[++i]), 1);
+    } else if (arg == "--threads" && has_value) {
+      thread_list = SplitList(argv[++i]);
+    } else if (arg == "--opt" && has_value) {
+      opt_list = SplitList(argv[++i]);
+    } else if (arg == "--providers" && has_value) {
+      provider_list = SplitList(argv[++i]);
+    } else if (arg == "--model" && has_value) {
+      model_name = argv[++i];
+    } else if (arg == "--input-size" && has_value) {
+      input_size = atoi(argv[++i]);
+    } else if (arg == "--max-frames" && has_value) {
+      max_frames = atoi(argv[++i]);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      args.clear();
+      break;
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() < 3) {
+    std::cout << "Usage: " << argv[0] << " [--warmup <n>] [--iterations <n>] [--threads <list>] [--opt <list>] [--providers <list>] [--model <name>] [--input-size <n>] [--max-frames <n>] <model-file> <label-file> <input>..." << std::endl;
+    std::cout << "Note: <input> may be an image, a directory of images or a video. Lists are comma separated, e.g. --threads 1,2,4 --opt basic,all --providers CPU,DNNL" << std::endl;
+    return -1;
+  }
+
+  GstOrtDetectionModel detection_model;
+  if (!ParseDetectionModel(model_name, detection_model)) {
+    std::cout << "Unable to recognize detection model " << model_name << "!" << std::endl;
+    return -1;
+  }
+
+  std::vector<BenchConfig> configs;
+  for (std::string const& provider_name : provider_list) {
+    for (std::string const& opt_name : opt_list) {
+      for (std::string const& threads : thread_list) {
+        BenchConfig config{provider_name, GST_ORT_EXECUTION_PROVIDER_CPU, opt_name, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, atoi(threads.c_str())};
+        if (!ParseProvider(provider_name, config.provider)) {
+          std::cout << "Unable to recognize execution provider " << provider_name << "!" << std::endl;
+          return -1;
+        }
+        if (!ParseOptimizationLevel(opt_name, config.opt_level)) {
+          std::cout << "Unable to recognize optimization level " << opt_name << "!" << std::endl;
+          return -1;
+        }
+        configs.push_back(config);
+      }
+    }
+  }
+
+  std::vector<cv::Mat> images;
+  for (size_t i = 2; i < args.size(); i++) {
+    if (!LoadInput(args[i], max_frames, images)) {
+      std::cout << "Unable to decode input " << args[i] << "!" << std::endl;
+      return -1;
+    }
+  }
+  std::cout << "Loaded " << images.size() << " frames" << std::endl;
+  std::vector<DetectionFrame> frames;
+  for (cv::Mat& image : images) {
+    // OpenCV decodes to BGR
+    frames.push_back(DetectionFrame{image.data, image.cols, image.rows, false});
+  }
+
+  printf("%-9s %-9s %7s %9s %8s | %-23s | %-23s | %-23s | %-23s\n", "provider", "opt", "threads", "load (ms)", "fps",
+      "preprocess p50/p95/p99", "run p50/p95/p99", "postprocess p50/p95/p99", "total p50/p95/p99");
+  for (BenchConfig const& config : configs) {
+    auto load_start = std::chrono::steady_clock::now();
+    OrtClient ort_client;
+    ort_client.SetSessionPool(1, config.threads, false);
+    ort_client.SetInputSize(input_size);
+    if (!ort_client.Init(args[0], args[1], config.opt_level, config.provider, detection_model)) {
+      printf("%-9s %-9s %7d   unable to initialize ORT client\n", config.provider_name.c_str(), config.opt_name.c_str(), config.threads);
+      continue;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+    if (ort_client.GetExecutionProvider() != config.provider) {
+      printf("%-9s %-9s %7d   provider unavailable (falls back to CPU), skipped\n", config.provider_name.c_str(), config.opt_name.c_str(), config.threads);
+      continue;
+    }
+
+    DetectionResults results;
+    bool res = true;
+    for (int i = 0; i < warmup && res; i++) {
+      res = ort_client.Detect(frames[i % frames.size()], results);
+    }
+    StageStats stats(iterations);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations && res; i++) {
+      auto frame_start = std::chrono::steady_clock::now();
+      res = ort_client.Detect(frames[i % frames.size()], results);
+      double total_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frame_start).count();
+      stats.AddFrame(results.GetTimings(), total_us, results.GetDetections(0).size());
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!res) {
+      printf("%-9s %-9s %7d   unable to run object detection\n", config.provider_name.c_str(), config.opt_name.c_str(), config.threads);
+      continue;
+    }
+    printf("%-9s %-9s %7d %9.1f %8.2f | %s | %s | %s | %s\n", config.provider_name.c_str(), config.opt_name.c_str(), config.threads,
+        load_ms, iterations / elapsed_s,
+        FormatStage(stats, INFERENCE_STAGE_PREPROCESS).c_str(), FormatStage(stats, INFERENCE_STAGE_RUN).c_str(),
+        FormatStage(stats, INFERENCE_STAGE_POSTPROCESS).c_str(), FormatStage(stats, INFERENCE_STAGE_TOTAL).c_str());
+    fflush(stdout);
+  }
+  return 0;
+}
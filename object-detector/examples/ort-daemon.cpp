@@ -0,0 +1,76 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include "src/ortclient.h"
+#include "src/ortdaemon.h"
+
+/**
+ * Local inference daemon, serving ortobjectdetector elements (daemon-socket property) and other
+ * OrtDaemonClient users on the same host from a single copy of the model.
+ * 
+ * Usage: ./ort-daemon <socket path> <path to ONNX model file> <path to label file for model> <optional execution provider> <optional max batch> <optional batch timeout>
+ * where the execution provider may be CPU, CUDA, DNNL, XNNPACK or OPENVINO (default is CPU), max batch is the
+ * maximum number of frames inferenced together (default 8) and batch timeout is the time in milliseconds
+ * a frame waits for other frames to batch with (default 2).
+ * 
+ * Frames are only batched together when the model has a dynamic batch dimension. The daemon runs until
+ * interrupted (SIGINT or SIGTERM), removing its socket on exit.
+ */
+
+static OrtDaemon *daemon_instance = nullptr;
+
+static void HandleSignal(int) {
+  if (daemon_instance) {
+    daemon_instance->Stop();
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4 || argc > 7) {
+    std::cout << "Usage: " << argv[0] << " <socket-path> <model-file> <label-file> <execution-provider> <max-batch> <batch-timeout-ms>" << std::endl;
+    std::cout << "Note: <execution-provider> is optional and defaults to CPU. Options are CPU, CUDA, DNNL, XNNPACK, OPENVINO" << std::endl;
+    std::cout << "Note: <max-batch> and <batch-timeout-ms> are optional and default to 8 and 2" << std::endl;
+    return -1;
+  }
+  std::string socket_path = argv[1];
+  GstOrtExecutionProvider provider = GST_ORT_EXECUTION_PROVIDER_CPU;
+  if (argc > 4) {
+    std::string exec_provider = argv[4];
+    if (exec_provider == "CPU") {
+      provider = GST_ORT_EXECUTION_PROVIDER_CPU;
+    } else if (exec_provider == "CUDA") {
+      provider = GST_ORT_EXECUTION_PROVIDER_CUDA;
+    } else if (exec_provider == "DNNL") {
+      provider = GST_ORT_EXECUTION_PROVIDER_DNNL;
+    } else if (exec_provider == "XNNPACK") {
+      provider = GST_ORT_EXECUTION_PROVIDER_XNNPACK;
+    } else if (exec_provider == "OPENVINO") {
+      provider = GST_ORT_EXECUTION_PROVIDER_OPENVINO;
+    } else {
+      std::cout << "Unable to recognize execution provider!" << std::endl;
+      return -1;
+    }
+  }
+  int max_batch = argc > 5 ? atoi(argv[5]) : 8;
+  double batch_timeout_ms = argc > 6 ? atof(argv[6]) : 2.0;
+
+  OrtClient ort_client;
+  if (!ort_client.Init(argv[2], argv[3], GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, provider) || !ort_client.Warmup(1)) {
+    std::cout << "Unable to initialize ORT client!" << std::endl;
+    return -1;
+  }
+
+  OrtDaemon daemon(ort_client);
+  daemon.SetBatching(max_batch, (int64_t) (batch_timeout_ms * 1000));
+  if (!daemon.Listen(socket_path)) {
+    std::cout << "Unable to listen on " << socket_path << std::endl;
+    return -1;
+  }
+  daemon_instance = &daemon;
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+  std::cout << "Listening on " << socket_path << std::endl;
+  bool res = daemon.Run();
+  daemon_instance = nullptr;
+  return res ? 0 : -1;
+}
@@ -1,37 +1,89 @@
 #include <iostream>
+#include <thread>
 #include <opencv2/opencv.hpp>
+#include "src/batchdetector.h"
 #include "src/ortclient.h"
 
 /**
  * Sample driver program to test ORT functionality without using the full plugin.
  * 
- * Usage: ./ort-driver <path to ONNX model file> <path to label file for model> <path to input image> <path to desired output image location> <optional execution provider>
- * where the execution provider may be CPU or CUDA (default is CPU). 
+ * Usage: ./ort-driver [options] <path to ONNX model file> <path to label file for model> <input> <output> <optional execution provider>
+ * where the execution provider may be CPU, CUDA, DNNL, XNNPACK or OPENVINO (default is CPU). 
  * 
  * Most common image formats should work, e.g. PNG, JPG, etc. as long as OpenCV supports it.
  * 
  * Currently, this driver only uses YOLOv4. However, as more object detection algorithms are implemented,
  * this will be a configurable CL arg as well.
  * 
- * Object detection will be run on input image, and the output image will essentially be a copy of the 
- * input image with bounding box information and accuracy scores written to it.
+ * If the input is a single image, object detection will be run on it, and the output image will essentially
+ * be a copy of the input image with bounding box information and accuracy scores written to it. Detections
+ * are also printed to stdout, one per line as: <label> <score> [xmin, ymin, xmax, ymax].
+ * 
+ * If the input is a directory (of images) or a .txt file listing image paths, one per line, all images are
+ * processed with a single model load (see BatchDetector). If the output is an existing directory, annotated
+ * images are written there under their original file names (numbered, e.g. image-1.jpg, when names repeat; the
+ * directory must not hold any of the inputs); otherwise detections are written to the output file as JSON lines.
+ * Options (batch mode only):
+ *   --workers <n>     threads decoding and encoding images, each (default: number of cores)
+ *   --sessions <n>    images inferenced concurrently, each on its own session (default 1)
+ *   --batch <n>       maximum images per inference call (default 1; batched in one session run
+ *                     for models with a dynamic batch size)
+ *   --queue <n>       maximum images waiting between stages (default 4 x workers)
  */
+
+// Whether input names a set of images rather than a single image
+static bool IsBatchInput(std::string const& input) {
+  size_t length = input.size();
+  return g_file_test(input.c_str(), G_FILE_TEST_IS_DIR) || (length > 4 && input.compare(length - 4, 4, ".txt") == 0);
+}
+
 int main(int argc, char* argv[]) {
-  if (argc != 5 && argc != 6) {
-    std::cout << "Usage: " << argv[0]  << " <model-file> <label-file> <input-image> <output-location> <execution-provider>" << std::endl;
-    std::cout << "Note: <execution-provider> is optional and defaults to CPU. Options are CPU, CUDA" << std::endl;
+  int workers = std::max((int) std::thread::hardware_concurrency(), 1);
+  int sessions = 1;
+  int batch = 1;
+  int queue = 0;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--workers" && has_value) {
+      workers = atoi(argv[++i]);
+    } else if (arg == "--sessions" && has_value) {
+      sessions = atoi(argv[++i]);
+    } else if (arg == "--batch" && has_value) {
+      batch = atoi(argv[++i]);
+    } else if (arg == "--queue" && has_value) {
+      queue = atoi(argv[++i]);
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() != 4 && args.size() != 5) {
+    std::cout << "Usage: " << argv[0]  << " [--workers <n>] [--sessions <n>] [--batch <n>] [--queue <n>] <model-file> <label-file> <input> <output-location> <execution-provider>" << std::endl;
+    std::cout << "Note: <execution-provider> is optional and defaults to CPU. Options are CPU, CUDA, DNNL, XNNPACK, OPENVINO" << std::endl;
+    std::cout << "Note: <input> may be an image, a directory of images or a .txt file listing images; <output-location> is then a directory for annotated images or a detections file" << std::endl;
     return -1;
   }
-  std::string model_path = argv[1];
-  std::string label_path = argv[2];
+  std::string model_path = args[0];
+  std::string label_path = args[1];
+  bool batch_mode = IsBatchInput(args[2]);
   OrtClient ort_client;
+  if (batch_mode) {
+    ort_client.SetSessionPool(sessions, 0, false);
+  }
   bool res;
-  if (argc == 6) {
-    std::string exec_provider = argv[5];
+  if (args.size() == 5) {
+    std::string exec_provider = args[4];
     if (exec_provider == "CPU") {
       res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_CPU);
     } else if (exec_provider == "CUDA") {
       res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_CUDA);
+    } else if (exec_provider == "DNNL") {
+      res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_DNNL);
+    } else if (exec_provider == "XNNPACK") {
+      res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_XNNPACK);
+    } else if (exec_provider == "OPENVINO") {
+      res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_OPENVINO);
     } else {
       std::cout << "Unable to recognize execution provider!" << std::endl;
       return -1;
@@ -40,9 +92,42 @@ int main(int argc, char* argv[]) {
     res = ort_client.Init(model_path, label_path, GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GST_ORT_EXECUTION_PROVIDER_CPU);
   }
   assert(res);
-  cv::Mat input_image = cv::imread(argv[3]);
+  if (batch_mode) {
+    std::vector<std::string> inputs;
+    if (!BatchDetector::ListInputs(args[2], inputs)) {
+      std::cout << "Unable to read input " << args[2] << "!" << std::endl;
+      return -1;
+    }
+    BatchDetector batch_detector(ort_client);
+    batch_detector.SetThreads(workers, sessions, workers);
+    batch_detector.SetBatching(batch, queue > 0 ? queue : 4 * workers);
+    if (g_file_test(args[3].c_str(), G_FILE_TEST_IS_DIR) ? !batch_detector.SetOutputDirectory(args[3]) : !batch_detector.SetDetectionsFile(args[3])) {
+      std::cout << "Unable to open output " << args[3] << "!" << std::endl;
+      return -1;
+    }
+    gint64 start = g_get_monotonic_time ();
+    res = batch_detector.Run(inputs);
+    double elapsed_s = (g_get_monotonic_time () - start) / 1e6;
+    std::cout << "Processed " << batch_detector.GetProcessed() << " of " << inputs.size() << " images ("
+              << batch_detector.GetFailed() << " failed) in " << elapsed_s << " s, "
+              << (elapsed_s > 0 ? batch_detector.GetProcessed() / elapsed_s : 0) << " images/s" << std::endl;
+    return res ? 0 : -1;
+  }
+  cv::Mat input_image = cv::imread(args[2]);
   // Imread reads in BGR format
-  ort_client.RunModel(input_image.data, input_image.cols, input_image.rows, false);
-  cv::imwrite(argv[4], input_image);
+  DetectionFrame frame{input_image.data, input_image.cols, input_image.rows, false};
+  DetectionResults results;
+  if (!ort_client.Detect(frame, results)) {
+    std::cout << "Unable to run object detection!" << std::endl;
+    return -1;
+  }
+  std::vector<std::string> const& labels = ort_client.GetClassLabels();
+  for (Detection const& detection : results.GetDetections(0)) {
+    std::cout << labels[detection.class_index] << " " << detection.score << " ["
+              << detection.xmin << ", " << detection.ymin << ", "
+              << detection.xmax << ", " << detection.ymax << "]" << std::endl;
+  }
+  DrawDetections(frame, results.GetDetections(0), labels);
+  cv::imwrite(args[3], input_image);
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,369 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <glib.h>
+#include "batchdetector.h"
+
+// File extensions of images picked up from input directories
+static const char *IMAGE_EXTENSIONS[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp", ".ppm", ".pgm"};
+
+// Escapes a string for use within a JSON string literal
+static std::string EscapeJson(std::string const& str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if ((unsigned char) c < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Absolute path with symbolic links resolved, or path itself if it cannot be resolved
+static std::string ResolvePath(std::string const& path) {
+  char *resolved = realpath(path.c_str(), NULL);
+  if (!resolved) {
+    return path;
+  }
+  std::string resolved_path = resolved;
+  free(resolved);
+  return resolved_path;
+}
+
+static bool HasImageExtension(std::string const& name) {
+  std::string lower = name;
+  for (char& c : lower) {
+    c = (char) tolower((unsigned char) c);
+  }
+  for (const char *extension : IMAGE_EXTENSIONS) {
+    size_t length = strlen(extension);
+    if (lower.size() > length && lower.compare(lower.size() - length, length, extension) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+BatchDetector::BatchDetector(OrtClient& ort_client) : ort_client(ort_client), decode_threads(2), inference_threads(1), encode_threads(2), max_batch(1), queue_size(16), score_threshold(0.25f), nms_threshold(0.213f), next_input(0), processed(0), failed(0) {}
+
+/**
+ * @brief Sets the number of worker threads of each pipeline stage. Inference
+ * threads should match the client's session pool size (see
+ * OrtClient::SetSessionPool), so that each can run a session of its own.
+ *
+ * @param decode_threads threads reading and decoding images.
+ * @param inference_threads threads running the model.
+ * @param encode_threads threads drawing and encoding images or writing detections.
+ */
+void BatchDetector::SetThreads(int decode_threads, int inference_threads, int encode_threads) {
+  this->decode_threads = std::max(decode_threads, 1);
+  this->inference_threads = std::max(inference_threads, 1);
+  this->encode_threads = std::max(encode_threads, 1);
+}
+
+/**
+ * @brief Sets how images are batched and buffered between stages.
+ *
+ * @param max_batch maximum number of images per inference call.
+ * @param queue_size maximum number of images waiting between two stages.
+ */
+void BatchDetector::SetBatching(size_t max_batch, size_t queue_size) {
+  this->max_batch = std::max<size_t>(max_batch, 1);
+  this->queue_size = std::max<size_t>(queue_size, this->max_batch);
+}
+
+void BatchDetector::SetThresholds(float score_threshold, float nms_threshold) {
+  this->score_threshold = score_threshold;
+  this->nms_threshold = nms_threshold;
+}
+
+/**
+ * @brief Writes each image, with its detections drawn, to dir under its
+ * original file name. Inputs with the same file name (from different
+ * directories) are numbered, e.g. image-1.jpg. Run fails if dir holds any of
+ * the inputs, as they would be overwritten.
+ *
+ * @param dir existing output directory.
+ * @return true if dir is a directory.
+ * @return false otherwise.
+ */
+bool BatchDetector::SetOutputDirectory(std::string const& dir) {
+  if (!g_file_test(dir.c_str(), G_FILE_TEST_IS_DIR)) {
+    GST_ERROR ("Output directory '%s' does not exist!", dir.c_str());
+    return false;
+  }
+  output_dir = dir;
+  return true;
+}
+
+/**
+ * @brief Writes detections to a file instead of annotated images, as one JSON
+ * object per image and line: {"image": <path>, "detections": [{"label": <label>,
+ * "score": <score>, "box": [xmin, ymin, xmax, ymax]}, ...]}. Lines are in
+ * completion order, not input order.
+ *
+ * @param path detections file path.
+ * @return true if the file was created.
+ * @return false otherwise.
+ */
+bool BatchDetector::SetDetectionsFile(std::string const& path) {
+  detections_file.open(path, std::ios::out | std::ios::trunc);
+  if (!detections_file.good()) {
+    GST_ERROR ("Unable to create detections file '%s'!", path.c_str());
+    return false;
+  }
+  output_dir.clear();
+  return true;
+}
+
+/**
+ * @brief Lists the images to process from a directory (its image files, by
+ * name) or a file list (one path per line).
+ *
+ * @param path directory or file list.
+ * @param inputs out-param to append image paths to.
+ * @return true if path could be read.
+ * @return false otherwise.
+ */
+bool BatchDetector::ListInputs(std::string const& path, std::vector<std::string>& inputs) {
+  if (g_file_test(path.c_str(), G_FILE_TEST_IS_DIR)) {
+    GDir *dir = g_dir_open(path.c_str(), 0, NULL);
+    if (!dir) {
+      return false;
+    }
+    std::vector<std::string> names;
+    const gchar *name;
+    while ((name = g_dir_read_name(dir)) != NULL) {
+      if (HasImageExtension(name)) {
+        names.push_back(name);
+      }
+    }
+    g_dir_close(dir);
+    std::sort(names.begin(), names.end());
+    for (std::string const& entry : names) {
+      gchar *entry_path = g_build_filename(path.c_str(), entry.c_str(), NULL);
+      inputs.push_back(entry_path);
+      g_free(entry_path);
+    }
+    return true;
+  }
+  std::ifstream list(path);
+  if (!list.good()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(list, line)) {
+    size_t end = line.find_last_not_of(" \t\r");
+    if (end != std::string::npos) {
+      inputs.push_back(line.substr(0, end + 1));
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Chooses the output path of each input: its file name within the
+ * output directory, numbered when an earlier input has the same file name.
+ *
+ * @param inputs image paths.
+ * @return true if output paths were assigned.
+ * @return false if an input is in the output directory.
+ */
+bool BatchDetector::AssignOutputPaths(std::vector<std::string> const& inputs) {
+  std::string resolved_output_dir = ResolvePath(output_dir);
+  std::unordered_set<std::string> used_names;
+  for (std::string const& input : inputs) {
+    gchar *dir_name = g_path_get_dirname(input.c_str());
+    bool in_output_dir = ResolvePath(dir_name) == resolved_output_dir;
+    g_free(dir_name);
+    if (in_output_dir) {
+      GST_ERROR ("Input '%s' is in output directory '%s' and would be overwritten!", input.c_str(), output_dir.c_str());
+      return false;
+    }
+    gchar *base_name = g_path_get_basename(input.c_str());
+    std::string name = base_name;
+    g_free(base_name);
+    size_t dot = name.find_last_of('.');
+    std::string stem = dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+    std::string extension = name.substr(stem.size());
+    std::string output_name = name;
+    for (int i = 1; !used_names.insert(output_name).second; i++) {
+      output_name = stem + "-" + std::to_string(i) + extension;
+    }
+    gchar *output_path = g_build_filename(output_dir.c_str(), output_name.c_str(), NULL);
+    output_paths.push_back(output_path);
+    g_free(output_path);
+  }
+  return true;
+}
+
+// Decode stage: reads images in input order until all inputs are taken
+void BatchDetector::Decode(std::vector<std::string> const& inputs, BoundedQueue<BatchImage>& decoded) {
+  for (size_t i = next_input++; i < inputs.size(); i = next_input++) {
+    BatchImage image;
+    image.path = inputs[i];
+    if (!output_paths.empty()) {
+      image.output_path = output_paths[i];
+    }
+    image.image = cv::imread(image.path);
+    if (image.image.empty()) {
+      GST_ERROR ("Unable to read image '%s'!", image.path.c_str());
+      failed++;
+      continue;
+    }
+    if (!decoded.Push(std::move(image))) {
+      return;
+    }
+  }
+}
+
+// Inference stage: detects objects in up to max_batch decoded images at a time
+void BatchDetector::Infer(BoundedQueue<BatchImage>& decoded, BoundedQueue<BatchImage>& inferenced) {
+  std::vector<BatchImage> batch;
+  std::vector<DetectionFrame> frames;
+  DetectionResults results;
+  while (decoded.Pop(batch, max_batch)) {
+    frames.clear();
+    for (BatchImage& image : batch) {
+      // Imread reads in BGR format
+      frames.push_back(DetectionFrame{image.image.data, image.image.cols, image.image.rows, false});
+    }
+    if (ort_client.DetectBatch(frames, results, score_threshold, nms_threshold)) {
+      for (size_t i = 0; i < batch.size(); i++) {
+        batch[i].detections = results.GetDetections(i);
+        inferenced.Push(std::move(batch[i]));
+      }
+    } else {
+      GST_ERROR ("Unable to run object detection on a batch of %zu images!", batch.size());
+      failed += batch.size();
+    }
+    batch.clear();
+  }
+}
+
+// Encode stage: writes annotated images or detections
+void BatchDetector::Encode(BoundedQueue<BatchImage>& inferenced) {
+  std::vector<std::string> const& labels = ort_client.GetClassLabels();
+  std::vector<BatchImage> images;
+  while (inferenced.Pop(images, 1)) {
+    BatchImage& image = images[0];
+    bool res;
+    if (!output_dir.empty()) {
+      DetectionFrame frame{image.image.data, image.image.cols, image.image.rows, false};
+      DrawDetections(frame, image.detections, labels);
+      res = cv::imwrite(image.output_path, image.image);
+      if (!res) {
+        GST_ERROR ("Unable to write image '%s'!", image.output_path.c_str());
+      }
+    } else {
+      std::ostringstream line;
+      line << "{\"image\": \"" << EscapeJson(image.path) << "\", \"detections\": [";
+      for (size_t i = 0; i < image.detections.size(); i++) {
+        Detection const& detection = image.detections[i];
+        line << (i == 0 ? "" : ", ") << "{\"label\": \"" << EscapeJson(labels[detection.class_index])
+             << "\", \"score\": " << detection.score << ", \"box\": [" << detection.xmin << ", "
+             << detection.ymin << ", " << detection.xmax << ", " << detection.ymax << "]}";
+      }
+      line << "]}\n";
+      std::lock_guard<std::mutex> guard(detections_lock);
+      detections_file << line.str();
+      res = detections_file.good();
+    }
+    if (res) {
+      processed++;
+    } else {
+      failed++;
+    }
+    images.clear();
+  }
+}
+
+/**
+ * @brief Processes all inputs, returning once every image has been written or
+ * has failed. The client must have been initialized and an output set.
+ *
+ * @param inputs image paths.
+ * @return true if every image was processed.
+ * @return false otherwise.
+ */
+bool BatchDetector::Run(std::vector<std::string> const& inputs) {
+  if (output_dir.empty() && !detections_file.is_open()) {
+    GST_ERROR ("No output directory or detections file set!");
+    return false;
+  }
+  output_paths.clear();
+  if (!output_dir.empty() && !AssignOutputPaths(inputs)) {
+    return false;
+  }
+  next_input = 0;
+  processed = 0;
+  failed = 0;
+  BoundedQueue<BatchImage> decoded(queue_size);
+  BoundedQueue<BatchImage> inferenced(queue_size);
+  std::vector<std::thread> decoders, inferencers, encoders;
+  for (int i = 0; i < decode_threads; i++) {
+    decoders.emplace_back(&BatchDetector::Decode, this, std::cref(inputs), std::ref(decoded));
+  }
+  for (int i = 0; i < inference_threads; i++) {
+    inferencers.emplace_back(&BatchDetector::Infer, this, std::ref(decoded), std::ref(inferenced));
+  }
+  for (int i = 0; i < encode_threads; i++) {
+    encoders.emplace_back(&BatchDetector::Encode, this, std::ref(inferenced));
+  }
+  // Each stage ends once the previous one has ended and its queue is drained
+  for (std::thread& thread : decoders) {
+    thread.join();
+  }
+  decoded.Close();
+  for (std::thread& thread : inferencers) {
+    thread.join();
+  }
+  inferenced.Close();
+  for (std::thread& thread : encoders) {
+    thread.join();
+  }
+  if (detections_file.is_open()) {
+    detections_file.flush();
+  }
+  return failed == 0;
+}
+
+// Number of images written by the last Run
+uint64_t BatchDetector::GetProcessed() {
+  return processed;
+}
+
+// Number of images that could not be read, inferenced or written by the last Run
+uint64_t BatchDetector::GetFailed() {
+  return failed;
+}
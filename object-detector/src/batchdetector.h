@@ -0,0 +1,154 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __BATCH_DETECTOR_H__
+#define __BATCH_DETECTOR_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "ortclient.h"
+
+/**
+ * @brief Queue between stages of the batch pipeline. Push blocks while the
+ * queue is full, bounding the number of decoded images in flight; Pop blocks
+ * while it is empty, until the queue is closed.
+ */
+template <typename T>
+class BoundedQueue {
+  private:
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+  public:
+    BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)), closed(false) {}
+
+    // Returns false if the queue was closed
+    bool Push(T&& item) {
+      std::unique_lock<std::mutex> guard(lock);
+      not_full.wait(guard, [this]() { return closed || items.size() < capacity; });
+      if (closed) {
+        return false;
+      }
+      items.push_back(std::move(item));
+      not_empty.notify_one();
+      return true;
+    }
+
+    /**
+     * @brief Waits for an item, then also takes whatever else is queued, up to
+     * max_items in total.
+     *
+     * @return false once the queue is closed and drained.
+     */
+    bool Pop(std::vector<T>& out, size_t max_items) {
+      std::unique_lock<std::mutex> guard(lock);
+      not_empty.wait(guard, [this]() { return closed || !items.empty(); });
+      if (items.empty()) {
+        return false;
+      }
+      for (size_t i = 0; i < max_items && !items.empty(); i++) {
+        out.push_back(std::move(items.front()));
+        items.pop_front();
+      }
+      not_full.notify_all();
+      return true;
+    }
+
+    // Wakes all waiters; queued items may still be popped
+    void Close() {
+      std::lock_guard<std::mutex> guard(lock);
+      closed = true;
+      not_empty.notify_all();
+      not_full.notify_all();
+    }
+};
+
+// Image passing through the batch pipeline
+struct BatchImage {
+  std::string path;
+  // Annotated image path, when writing to an output directory
+  std::string output_path;
+  cv::Mat image;
+  std::vector<Detection> detections;
+};
+
+/**
+ * @brief Detects objects in a set of stored images with a single model load.
+ * Decoding, inference and encoding run as a pipeline on their own worker
+ * threads, connected by bounded queues, so that all cores are kept busy and
+ * memory stays bounded however many images there are. Inference threads take
+ * up to max_batch decoded images at a time and run them with
+ * OrtClient::DetectBatch (as one session run for models with a dynamic batch
+ * size).
+ *
+ * Results are written as annotated images to an output directory, or as
+ * detections, one per line, to a detections file.
+ */
+class BatchDetector {
+  private:
+    OrtClient& ort_client;
+    int decode_threads;
+    int inference_threads;
+    int encode_threads;
+    size_t max_batch;
+    size_t queue_size;
+    float score_threshold;
+    float nms_threshold;
+    std::string output_dir;
+    // Output path of each input, assigned by Run when writing to output_dir
+    std::vector<std::string> output_paths;
+    std::mutex detections_lock;
+    std::ofstream detections_file;
+    std::atomic<size_t> next_input;
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> failed;
+
+    void Decode(std::vector<std::string> const& inputs, BoundedQueue<BatchImage>& decoded);
+    void Infer(BoundedQueue<BatchImage>& decoded, BoundedQueue<BatchImage>& inferenced);
+    void Encode(BoundedQueue<BatchImage>& inferenced);
+    bool AssignOutputPaths(std::vector<std::string> const& inputs);
+
+  public:
+    BatchDetector(OrtClient& ort_client);
+    void SetThreads(int decode_threads, int inference_threads, int encode_threads);
+    void SetBatching(size_t max_batch, size_t queue_size);
+    void SetThresholds(float score_threshold, float nms_threshold);
+    bool SetOutputDirectory(std::string const& dir);
+    bool SetDetectionsFile(std::string const& path);
+    bool Run(std::vector<std::string> const& inputs);
+    uint64_t GetProcessed();
+    uint64_t GetFailed();
+    static bool ListInputs(std::string const& path, std::vector<std::string>& inputs);
+};
+
+#endif
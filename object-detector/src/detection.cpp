@@ -0,0 +1,89 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <sstream>
+#include <opencv2/opencv.hpp>
+#include "detection.h"
+
+// Unique, constant color for a class index, with hue depending on class index.
+static cv::Scalar ClassColor(int class_index, size_t num_classes) {
+  // Convert HSV to RGB
+  // Saturation and Value will always be 1
+  float h = ((1.0f * class_index) / num_classes) * 360;
+  float x = 1.0f - std::abs(std::fmod(h / 60, 2) - 1);
+  float r, g, b;
+  if (h >= 0 && h < 60) {
+    r = 255, g = x * 255, b = 0;
+  } else if (h >= 60 && h < 120) {
+    r = x * 255, g = 255, b = 0;
+  } else if (h >= 120 && h < 180) {
+    r = 0, g = 255, b = x * 255;
+  } else if (h >= 180 && h < 240) {
+    r = 0, g = x * 255, b = 255;
+  } else if (h >= 240 && h < 300) {
+    r = x * 255, g = 0, b = 255;
+  } else {
+    r = 255, g = 0, b = x * 255;
+  }
+  return cv::Scalar(r, g, b);
+}
+
+/**
+ * @brief Write bounding boxes and class labels/scores of detections to frame.
+ * 
+ * @param frame frame the detections were found in.
+ * @param detections detections to draw.
+ * @param class_labels class names, indexed by class index.
+ */
+void DrawDetections(DetectionFrame const& frame, std::vector<Detection> const& detections, std::vector<std::string> const& class_labels) {
+  // NOTE: this does not copy data, simply wraps
+  cv::Mat image(frame.height, frame.width, CV_8UC3, frame.data);
+  float font_scale = 0.5f;
+  int bbox_thick = (int) (0.6f * (frame.height + frame.width) / 600.f);
+
+  for (Detection const& detection : detections) {
+    if (detection.class_index < 0 || (size_t) detection.class_index >= class_labels.size()) {
+      continue;
+    }
+    std::string const& class_name = class_labels[detection.class_index];
+    auto c1 = cv::Point(detection.xmin, detection.ymin);
+    auto c2 = cv::Point(detection.xmax, detection.ymax);
+
+    cv::Scalar color = ClassColor(detection.class_index, class_labels.size());
+    // Shift color for consistency if image is BGR
+    if (!frame.is_rgb) {
+      auto temp = color[0];
+      color[0] = color[2];
+      color[2] = temp;
+    }
+    // Place rectangle around bounding box
+    cv::rectangle(image, cv::Rect(c1, c2), color, bbox_thick);
+
+    std::stringstream msg;
+    msg << class_name << ": " << roundf(detection.score * 100) / 100;
+    int base_line = 0;
+    auto t_size = cv::getTextSize(msg.str(), 0, font_scale, bbox_thick / 2, &base_line);
+    // Place rectangle for class label & score message
+    cv::rectangle(image, c1, cv::Point(c1.x + t_size.width, c1.y - t_size.height - 3), color, -1);
+    // Place message
+    cv::putText(image, msg.str(), cv::Point(detection.xmin, detection.ymin - 2), cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(0, 0, 0), bbox_thick / 2);
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DETECTION_H__
+#define __DETECTION_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Object detected in a frame, in frame (pixel) coordinates
+struct Detection {
+  float xmin;
+  float ymin;
+  float xmax;
+  float ymax;
+  float score;
+  int class_index;
+};
+
+// Time in microseconds spent in each stage of a detection call
+struct DetectionTimings {
+  double preprocess_us = 0;
+  double run_us = 0;
+  double postprocess_us = 0;
+  double draw_us = 0;
+  // Monotonic clock time in microseconds at which each stage (first) started, 0 if it did not run
+  int64_t preprocess_start_us = 0;
+  int64_t run_start_us = 0;
+  int64_t postprocess_start_us = 0;
+  int64_t draw_start_us = 0;
+};
+
+// Interleaved 8-bit, 3 channel image to detect objects in
+struct DetectionFrame {
+  uint8_t *data;
+  int width;
+  int height;
+  bool is_rgb;
+};
+
+/**
+ * @brief Caller-owned buffer of per-frame detections. Storage is kept when the
+ * buffer is reused, so repeated detection calls do not allocate once the buffer
+ * has grown to the number of frames and detections seen.
+ */
+class DetectionResults {
+  private:
+    std::vector<std::vector<Detection>> frames;
+    size_t num_frames = 0;
+    DetectionTimings timings;
+
+  public:
+    // Prepares buffer for `count` frames, each without detections
+    void Reset(size_t count) {
+      if (frames.size() < count) {
+        frames.resize(count);
+      }
+      for (size_t i = 0; i < count; i++) {
+        frames[i].clear();
+      }
+      num_frames = count;
+      timings = DetectionTimings();
+    }
+
+    size_t GetNumFrames() const {
+      return num_frames;
+    }
+
+    std::vector<Detection>& GetDetections(size_t frame) {
+      return frames[frame];
+    }
+
+    std::vector<Detection> const& GetDetections(size_t frame) const {
+      return frames[frame];
+    }
+
+    // Stage timings of the call that filled the buffer (for all its frames together)
+    DetectionTimings& GetTimings() {
+      return timings;
+    }
+
+    DetectionTimings const& GetTimings() const {
+      return timings;
+    }
+};
+
+void DrawDetections(DetectionFrame const& frame, std::vector<Detection> const& detections, std::vector<std::string> const& class_labels);
+
+#endif
@@ -61,6 +61,9 @@ gst_ort_execution_provider_get_type (void)
     static GEnumValue execution_provider_types[] = {
       {GST_ORT_EXECUTION_PROVIDER_CPU, "CPU execution provider", "cpu"},
       {GST_ORT_EXECUTION_PROVIDER_CUDA, "CUDA execution provider", "cuda"},
+      {GST_ORT_EXECUTION_PROVIDER_DNNL, "oneDNN (DNNL) CPU execution provider", "dnnl"},
+      {GST_ORT_EXECUTION_PROVIDER_XNNPACK, "XNNPACK CPU execution provider", "xnnpack"},
+      {GST_ORT_EXECUTION_PROVIDER_OPENVINO, "OpenVINO execution provider", "openvino"},
       {0, NULL, NULL},
     };
 
@@ -81,6 +84,7 @@ gst_ort_detection_model_get_type (void)
   if (g_once_init_enter (&ort_model_type)) {
     static GEnumValue model_types[] = {
       {GST_ORT_DETECTION_MODEL_YOLOV4, "YOLOv4 object detection model", "yolov4"},
+      {GST_ORT_DETECTION_MODEL_YOLOV8, "YOLOv8 (anchor-free) object detection model", "yolov8"},
       {0, NULL, NULL},
     };
 
@@ -91,4 +95,27 @@ gst_ort_detection_model_get_type (void)
   }
 
   return ort_model_type;
-}
\ No newline at end of file
+}
+
+GType
+gst_ort_scheduler_policy_get_type (void)
+{
+  static GType ort_scheduler_policy_type = 0;
+
+  if (g_once_init_enter (&ort_scheduler_policy_type)) {
+    static GEnumValue scheduler_policy_types[] = {
+      {GST_ORT_SCHEDULER_POLICY_DEFAULT,
+          "Keep the scheduler's policy (GST_ORT_SCHEDULER_POLICY, else earliest deadline first)", "default"},
+      {GST_ORT_SCHEDULER_POLICY_EDF, "Earliest deadline first", "edf"},
+      {GST_ORT_SCHEDULER_POLICY_FAIR, "Fair sharing in proportion to priority", "fair"},
+      {0, NULL, NULL},
+    };
+
+    GType temp = g_enum_register_static ("GstOrtSchedulerPolicy",
+        scheduler_policy_types);
+
+    g_once_init_leave (&ort_scheduler_policy_type, temp);
+  }
+
+  return ort_scheduler_policy_type;
+}
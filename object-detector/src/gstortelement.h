@@ -35,14 +35,25 @@ typedef enum {
 // Supported ORT execution providers.
 typedef enum {
   GST_ORT_EXECUTION_PROVIDER_CPU,
-  GST_ORT_EXECUTION_PROVIDER_CUDA
+  GST_ORT_EXECUTION_PROVIDER_CUDA,
+  GST_ORT_EXECUTION_PROVIDER_DNNL,
+  GST_ORT_EXECUTION_PROVIDER_XNNPACK,
+  GST_ORT_EXECUTION_PROVIDER_OPENVINO
 } GstOrtExecutionProvider;
 
 // Supported object detection models.
 typedef enum {
-  GST_ORT_DETECTION_MODEL_YOLOV4
+  GST_ORT_DETECTION_MODEL_YOLOV4,
+  GST_ORT_DETECTION_MODEL_YOLOV8
 } GstOrtDetectionModel;
 
+// Policy of the process-wide inference scheduler.
+typedef enum {
+  GST_ORT_SCHEDULER_POLICY_DEFAULT,
+  GST_ORT_SCHEDULER_POLICY_EDF,
+  GST_ORT_SCHEDULER_POLICY_FAIR
+} GstOrtSchedulerPolicy;
+
 G_BEGIN_DECLS
 
 GType gst_ort_optimization_level_get_type (void);
@@ -54,6 +65,9 @@ GType gst_ort_execution_provider_get_type (void);
 GType gst_ort_detection_model_get_type (void);
 #define GST_TYPE_ORT_DETECTION_MODEL (gst_ort_detection_model_get_type ())
 
+GType gst_ort_scheduler_policy_get_type (void);
+#define GST_TYPE_ORT_SCHEDULER_POLICY (gst_ort_scheduler_policy_get_type ())
+
 G_END_DECLS
 
 #endif
\ No newline at end of file
@@ -31,7 +31,96 @@
  * 
  * Users may control the specific object detection model used, optimization level,
  * execution provider, filtering thresholds, and hardware acceleration device.
+ *
+ * Besides CPU and CUDA, the CPU-oriented oneDNN (dnnl), XNNPACK and OpenVINO
+ * execution providers may be selected when ONNX Runtime was built with them.
+ * If a selected CPU provider is unavailable, the default CPU provider is used.
  * 
+ * For high resolution video, frames may be split into an overlapping grid of tiles
+ * (see tile-rows, tile-columns, tile-overlap). Tiles are inferenced as a single
+ * batch and detections at tile seams are merged, improving small object recall
+ * at a compute cost proportional to the number of tiles. Tiling requires a model
+ * with a dynamic batch dimension.
+ *
+ * Models exported with dynamic input height/width may be run at a different
+ * resolution (e.g. 320 or 608) with the input-size property, trading accuracy
+ * for inference cost without re-exporting the model.
+ *
+ * The ORT session is created (and warmed up with warmup-iterations inferences
+ * on a blank frame) when the element starts, rather than on the first buffer.
+ * With async-init enabled, this happens on a background thread and frames pass
+ * through unmodified until the session is ready.
+ *
+ * With mmap-model and cache-dir set, the cached ORT format model is
+ * memory-mapped read-only and its weights are used in place, so processes
+ * running the same model share them through the page cache. Without cache-dir,
+ * mmap-model has no effect: ORT copies ONNX models into buffers of its own.
+ *
+ * Setting model-file or label-file while the element is running hot-swaps the
+ * model: the new session is built and warmed up on a background thread while
+ * the current one keeps processing frames, then swapped in between frames.
+ *
+ * Setting cache-dir stores the optimized model in ORT format, keyed on the model
+ * contents, ORT version, session options and provider options. Later pipeline
+ * starts load the cached model directly instead of re-running graph
+ * optimization. The model is only hashed again when its size or modification
+ * time changes, and the entry of its previous contents is then removed.
+ * Pipelines may share a cache directory; entries for other options or models
+ * are left alone.
+ *
+ * On hosts with many cores, num-sessions creates a pool of sessions sharing the
+ * model weights, each with a small thread pool of session-threads threads
+ * (optionally pinned to their own cores with pin-session-threads). Frames are
+ * inferenced concurrently on the least-loaded session, and pushed downstream in
+ * their original order. Up to num-sessions frames are in flight at a time.
+ *
+ * Elements in the same process may share CPU through a process-wide inference
+ * scheduler (use-scheduler). It runs scheduler-slots inferences at a time (by
+ * default GST_ORT_SCHEDULER_SLOTS, else the number of processors), serving
+ * waiting frames earliest-deadline-first, or in proportion to each element's
+ * priority with scheduler-policy=fair (or GST_ORT_SCHEDULER_POLICY=fair). The
+ * scheduler is shared, so the element started last sets these. Frames that can no
+ * longer be inferenced within their deadline (milliseconds after arrival) are
+ * passed on without inference. frames-served and frames-dropped count the frames
+ * inferenced and shed.
+ *
+ * The element times each stage of inference (preprocess, run, postprocess, draw)
+ * with the monotonic clock. stats holds the mean, median, 95th and 99th percentile
+ * of each stage over the last 512 inferenced frames (in milliseconds), along with
+ * the frames, detections and frames-skipped counters (frames passed on without
+ * inference, e.g. by inference-interval or deadline). With stats-interval set, the
+ * same structure is posted as an element message named "ortobjectdetector-stats"
+ * every stats-interval milliseconds. For latency histograms across elements,
+ * see the ortstats tracer (GST_TRACERS=ortstats).
+ *
+ * With trace-file set, each inferenced frame's stages are recorded as spans
+ * (tagged with the frame's PTS, on the thread that ran them) and written to that
+ * file in Chrome trace event format, viewable in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. If enable-profiling is set as well, the ORT sessions'
+ * operator timings are merged into the same timeline when the element stops.
+ * The file is rewritten each time the element starts.
+ *
+ * With enable-profiling, ORT's own profiler records every operator run of the
+ * first profile-frames inferenced frames after the model is loaded (warm-up
+ * included), writing one JSON profile per session named after profile-prefix.
+ * When the element stops, kernel time per operator type and execution provider
+ * is logged at INFO level, to compare optimization levels and providers. With
+ * trace-file set, the same events are merged into the trace.
+ *
+ * With daemon-socket set, the element is a thin client of an ort-daemon process
+ * listening on that Unix socket, and loads no model itself. Frames are handed to
+ * the daemon through shared memory, and the daemon batches frames of all its
+ * clients together. Model, provider, tiling and session properties are then those
+ * the daemon was started with, and model-file/label-file are not needed.
+ *
+ * Inference may be run on every n-th frame only (inference-interval). With
+ * adaptive-quality enabled, the element measures inference latency against
+ * target-latency (or the frame period of target-fps) and automatically raises
+ * the inference interval, pre-filters more boxes by score and, for dynamic-shape
+ * models, lowers the input size when over budget, restoring quality once
+ * headroom returns. Each adjustment is posted as an element message named
+ * "ortobjectdetector-quality" on the bus.
+ *
  * The plugin supports either RGB or BGR video data in GST's video/x-raw format.
  * It outputs the same data format.
  *
@@ -73,6 +162,7 @@
 #include <gst/video/gstvideometa.h>
 
 #include "gstortobjectdetector.h"
+#include "gstortstatstracer.h"
 #include "ortclient.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_ortobjectdetector_debug);
@@ -88,7 +178,42 @@ enum
   PROP_SCORE_THRESHOLD,
   PROP_NMS_THRESHOLD,
   PROP_DETECTION_MODEL,
-  PROP_DEVICE_ID
+  PROP_DEVICE_ID,
+  PROP_TILE_ROWS,
+  PROP_TILE_COLUMNS,
+  PROP_TILE_OVERLAP,
+  PROP_INPUT_SIZE,
+  PROP_INFERENCE_INTERVAL,
+  PROP_ADAPTIVE_QUALITY,
+  PROP_TARGET_LATENCY,
+  PROP_TARGET_FPS,
+  PROP_CACHE_DIR,
+  PROP_ASYNC_INIT,
+  PROP_WARMUP_ITERATIONS,
+  PROP_MMAP_MODEL,
+  PROP_DNNL_USE_ARENA,
+  PROP_XNNPACK_THREADS,
+  PROP_OPENVINO_DEVICE_TYPE,
+  PROP_NUM_SESSIONS,
+  PROP_SESSION_THREADS,
+  PROP_PIN_SESSION_THREADS,
+  PROP_USE_SCHEDULER,
+  PROP_PRIORITY,
+  PROP_DEADLINE,
+  PROP_SCHEDULER_SLOTS,
+  PROP_SCHEDULER_POLICY,
+  PROP_FRAMES_SERVED,
+  PROP_FRAMES_DROPPED,
+  PROP_DAEMON_SOCKET,
+  PROP_FRAMES,
+  PROP_DETECTIONS,
+  PROP_FRAMES_SKIPPED,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_TRACE_FILE,
+  PROP_ENABLE_PROFILING,
+  PROP_PROFILE_PREFIX,
+  PROP_PROFILE_FRAMES
 };
 
 // Default prop values
@@ -98,6 +223,32 @@ enum
 #define DEFAULT_OPTIMIZATION_LEVEL GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED
 #define DEFAULT_DETECTION_MODEL GST_ORT_DETECTION_MODEL_YOLOV4
 #define DEFAULT_DEVICE_ID 0
+#define DEFAULT_TILE_ROWS 1
+#define DEFAULT_TILE_COLUMNS 1
+#define DEFAULT_TILE_OVERLAP 0.2f
+#define DEFAULT_INPUT_SIZE 0
+#define DEFAULT_INFERENCE_INTERVAL 1
+#define DEFAULT_ADAPTIVE_QUALITY FALSE
+#define DEFAULT_TARGET_LATENCY 0.0f
+#define DEFAULT_TARGET_FPS 0.0f
+#define DEFAULT_ASYNC_INIT FALSE
+#define DEFAULT_WARMUP_ITERATIONS 1
+#define DEFAULT_MMAP_MODEL FALSE
+#define DEFAULT_DNNL_USE_ARENA TRUE
+#define DEFAULT_XNNPACK_THREADS 0
+#define DEFAULT_OPENVINO_DEVICE_TYPE "CPU_FP32"
+#define DEFAULT_NUM_SESSIONS 1
+#define DEFAULT_SESSION_THREADS 0
+#define DEFAULT_PIN_SESSION_THREADS FALSE
+#define DEFAULT_USE_SCHEDULER FALSE
+#define DEFAULT_PRIORITY 1
+#define DEFAULT_DEADLINE 0.0f
+#define DEFAULT_SCHEDULER_SLOTS 0
+#define DEFAULT_SCHEDULER_POLICY GST_ORT_SCHEDULER_POLICY_DEFAULT
+#define DEFAULT_STATS_INTERVAL 0.0f
+#define DEFAULT_ENABLE_PROFILING FALSE
+#define DEFAULT_PROFILE_PREFIX "ortobjectdetector-profile"
+#define DEFAULT_PROFILE_FRAMES 100
 
 /* the capabilities of the inputs and outputs.
  *
@@ -125,8 +276,19 @@ static void gst_ortobjectdetector_set_property (GObject * object,
 static void gst_ortobjectdetector_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
 
+static void gst_ortobjectdetector_request_swap (Gstortobjectdetector * self);
+static GstStructure *gst_ortobjectdetector_get_stats (Gstortobjectdetector * self);
+
+static gboolean gst_ortobjectdetector_start (GstBaseTransform * base);
+static gboolean gst_ortobjectdetector_stop (GstBaseTransform * base);
 static GstFlowReturn gst_ortobjectdetector_transform_ip (GstBaseTransform *
     base, GstBuffer * outbuf);
+static GstFlowReturn gst_ortobjectdetector_submit_input_buffer (GstBaseTransform *
+    base, gboolean is_discont, GstBuffer * input);
+static GstFlowReturn gst_ortobjectdetector_generate_output (GstBaseTransform *
+    base, GstBuffer ** outbuf);
+static gboolean gst_ortobjectdetector_sink_event (GstBaseTransform * base,
+    GstEvent * event);
 
 static void gst_ortobjectdetector_finalize (GObject * object);
 
@@ -179,6 +341,146 @@ gst_ortobjectdetector_class_init (GstortobjectdetectorClass * klass)
       g_param_spec_int ("device-id", "Device ID", "Device ID for hardware acceleration",
         0, G_MAXINT, 0, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+  g_object_class_install_property (gobject_class, PROP_TILE_ROWS,
+      g_param_spec_int ("tile-rows", "Tile rows", "Number of tile rows each frame is split into for inferencing",
+        1, 16, DEFAULT_TILE_ROWS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_COLUMNS,
+      g_param_spec_int ("tile-columns", "Tile columns", "Number of tile columns each frame is split into for inferencing",
+        1, 16, DEFAULT_TILE_COLUMNS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_OVERLAP,
+      g_param_spec_float ("tile-overlap", "Tile overlap", "Fraction of a tile's width/height overlapping with neighbouring tiles",
+          0.0, 0.9, DEFAULT_TILE_OVERLAP, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_INPUT_SIZE,
+      g_param_spec_int ("input-size", "Input size", "Model input width/height for models with dynamic input shape (0 = model default)",
+        0, 4096, DEFAULT_INPUT_SIZE, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_INFERENCE_INTERVAL,
+      g_param_spec_int ("inference-interval", "Inference interval", "Run inference on every n-th frame only",
+        1, G_MAXINT, DEFAULT_INFERENCE_INTERVAL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE_QUALITY,
+      g_param_spec_boolean ("adaptive-quality", "Adaptive quality", "Automatically adjust inference quality to meet target-latency or target-fps",
+          DEFAULT_ADAPTIVE_QUALITY, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TARGET_LATENCY,
+      g_param_spec_float ("target-latency", "Target latency", "Average per-frame processing budget in milliseconds for adaptive quality (0 = use target-fps)",
+          0.0, G_MAXFLOAT, DEFAULT_TARGET_LATENCY, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TARGET_FPS,
+      g_param_spec_float ("target-fps", "Target FPS", "Frame rate to sustain with adaptive quality, used when target-latency is 0",
+          0.0, G_MAXFLOAT, DEFAULT_TARGET_FPS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_DIR,
+      g_param_spec_string ("cache-dir", "Model cache directory", "Directory to cache optimized models in for faster startup (unset = no caching)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ASYNC_INIT,
+      g_param_spec_boolean ("async-init", "Asynchronous initialization", "Create ORT session on a background thread, passing frames through until ready",
+          DEFAULT_ASYNC_INIT, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_WARMUP_ITERATIONS,
+      g_param_spec_int ("warmup-iterations", "Warm-up iterations", "Number of inferences on a blank frame to run before processing video",
+        0, G_MAXINT, DEFAULT_WARMUP_ITERATIONS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MMAP_MODEL,
+      g_param_spec_boolean ("mmap-model", "Memory-map model", "Memory-map the cached ORT format model, sharing its weights between processes (requires cache-dir)",
+          DEFAULT_MMAP_MODEL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DNNL_USE_ARENA,
+      g_param_spec_boolean ("dnnl-use-arena", "oneDNN memory arena", "Use memory arena with the oneDNN execution provider",
+          DEFAULT_DNNL_USE_ARENA, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_XNNPACK_THREADS,
+      g_param_spec_int ("xnnpack-threads", "XNNPACK threads", "Size of XNNPACK execution provider thread pool (0 = ORT default)",
+        0, G_MAXINT, DEFAULT_XNNPACK_THREADS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OPENVINO_DEVICE_TYPE,
+      g_param_spec_string ("openvino-device-type", "OpenVINO device type", "Device type for the OpenVINO execution provider (e.g. CPU_FP32)",
+          DEFAULT_OPENVINO_DEVICE_TYPE, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NUM_SESSIONS,
+      g_param_spec_int ("num-sessions", "Number of sessions", "Number of ORT sessions inferencing frames concurrently",
+        1, 256, DEFAULT_NUM_SESSIONS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SESSION_THREADS,
+      g_param_spec_int ("session-threads", "Threads per session", "Number of intra-op threads of each ORT session (0 = ORT default)",
+        0, G_MAXINT, DEFAULT_SESSION_THREADS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PIN_SESSION_THREADS,
+      g_param_spec_boolean ("pin-session-threads", "Pin session threads", "Pin the threads of each ORT session to their own set of cores",
+          DEFAULT_PIN_SESSION_THREADS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_USE_SCHEDULER,
+      g_param_spec_boolean ("use-scheduler", "Use scheduler", "Share inference time with other elements through the process-wide inference scheduler",
+          DEFAULT_USE_SCHEDULER, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PRIORITY,
+      g_param_spec_int ("priority", "Priority", "Scheduling priority (weight under fair scheduling)",
+        1, 100, DEFAULT_PRIORITY, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DEADLINE,
+      g_param_spec_float ("deadline", "Deadline", "Time in milliseconds after arrival by which a frame must be inferenced, or be passed on without inference (0 = none)",
+          0.0, G_MAXFLOAT, DEFAULT_DEADLINE, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SCHEDULER_SLOTS,
+      g_param_spec_int ("scheduler-slots", "Scheduler slots", "Number of inferences the process-wide scheduler runs at a time, applied on start (0 = keep: GST_ORT_SCHEDULER_SLOTS, else number of processors)",
+        0, G_MAXINT, DEFAULT_SCHEDULER_SLOTS, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SCHEDULER_POLICY,
+      g_param_spec_enum ("scheduler-policy", "Scheduler policy", "Policy of the process-wide scheduler, applied on start",
+          GST_TYPE_ORT_SCHEDULER_POLICY, DEFAULT_SCHEDULER_POLICY, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES_SERVED,
+      g_param_spec_uint64 ("frames-served", "Frames served", "Number of frames inferenced",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES_DROPPED,
+      g_param_spec_uint64 ("frames-dropped", "Frames dropped", "Number of frames passed on without inference as they could not meet their deadline",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DAEMON_SOCKET,
+      g_param_spec_string ("daemon-socket", "Daemon socket", "Unix socket of an ort-daemon to run inference in, instead of loading the model in-process (unset = in-process)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES,
+      g_param_spec_uint64 ("frames", "Frames", "Number of frames processed, inferenced or skipped",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DETECTIONS,
+      g_param_spec_uint64 ("detections", "Detections", "Number of objects detected",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES_SKIPPED,
+      g_param_spec_uint64 ("frames-skipped", "Frames skipped", "Number of frames passed on without inference",
+          0, G_MAXUINT64, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Frame counters and per-stage timing statistics (mean/p50/p95/p99 in milliseconds)",
+          GST_TYPE_STRUCTURE, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_float ("stats-interval", "Statistics interval", "Interval in milliseconds at which statistics are posted on the bus (0 = never)",
+          0.0, G_MAXFLOAT, DEFAULT_STATS_INTERVAL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRACE_FILE,
+      g_param_spec_string ("trace-file", "Trace file", "Chrome trace (JSON) file to write per-frame inference spans (and ORT profiling events, with enable-profiling) to (unset = no tracing)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ENABLE_PROFILING,
+      g_param_spec_boolean ("enable-profiling", "Enable profiling", "Profile ORT sessions, logging per-operator time when stopping",
+          DEFAULT_ENABLE_PROFILING, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PROFILE_PREFIX,
+      g_param_spec_string ("profile-prefix", "Profile prefix", "File name prefix of ORT session profiles",
+          DEFAULT_PROFILE_PREFIX, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PROFILE_FRAMES,
+      g_param_spec_uint ("profile-frames", "Profile frames", "Number of inferenced frames to profile ORT sessions for (0 = until stopped)",
+          0, G_MAXUINT, DEFAULT_PROFILE_FRAMES, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
   gst_element_class_set_details_simple (gstelement_class,
       "ortobjectdetector",
       "Generic/Filter",
@@ -189,8 +491,18 @@ gst_ortobjectdetector_class_init (GstortobjectdetectorClass * klass)
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sink_template));
 
+  GST_BASE_TRANSFORM_CLASS (klass)->start =
+      GST_DEBUG_FUNCPTR (gst_ortobjectdetector_start);
+  GST_BASE_TRANSFORM_CLASS (klass)->stop =
+      GST_DEBUG_FUNCPTR (gst_ortobjectdetector_stop);
   GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
       GST_DEBUG_FUNCPTR (gst_ortobjectdetector_transform_ip);
+  GST_BASE_TRANSFORM_CLASS (klass)->submit_input_buffer =
+      GST_DEBUG_FUNCPTR (gst_ortobjectdetector_submit_input_buffer);
+  GST_BASE_TRANSFORM_CLASS (klass)->generate_output =
+      GST_DEBUG_FUNCPTR (gst_ortobjectdetector_generate_output);
+  GST_BASE_TRANSFORM_CLASS (klass)->sink_event =
+      GST_DEBUG_FUNCPTR (gst_ortobjectdetector_sink_event);
 
   /* debug category for fltering log messages */
   GST_DEBUG_CATEGORY_INIT (gst_ortobjectdetector_debug, "ortobjectdetector", 0,
@@ -203,13 +515,71 @@ gst_ortobjectdetector_class_init (GstortobjectdetectorClass * klass)
 static void
 gst_ortobjectdetector_init (Gstortobjectdetector * self)
 {
-  self->ort_client = std::unique_ptr<OrtClient>(new OrtClient());
+  // Instance memory is only zeroed by GObject; construct C++ members in place
+  new (&self->ort_client) std::shared_ptr<OrtClient> ();
+  new (&self->daemon_client) std::shared_ptr<OrtDaemonClient> ();
+  new (&self->governor) std::unique_ptr<QualityGovernor> (new QualityGovernor ());
+  new (&self->frames_served) std::atomic<guint64> (0);
+  new (&self->frames_dropped) std::atomic<guint64> (0);
+  new (&self->stats) std::unique_ptr<StageStats> (new StageStats ());
+  new (&self->last_stats_post) std::atomic<gint64> (0);
+  new (&self->trace_writer) std::unique_ptr<TraceWriter> ();
+  new (&self->profiled_frames) std::atomic<guint64> (0);
+  new (&self->profiles) std::vector<SessionProfile> ();
+  g_mutex_init (&self->setup_lock);
+  g_mutex_init (&self->client_lock);
+  g_cond_init (&self->client_cond);
+  g_mutex_init (&self->quality_lock);
+  g_mutex_init (&self->resize_lock);
+  g_mutex_init (&self->frame_lock);
+  g_cond_init (&self->frame_cond);
+  g_queue_init (&self->frame_queue);
+  self->frame_pool = NULL;
+  self->init_thread = NULL;
+  self->swap_thread = NULL;
+  self->started = FALSE;
+  self->swap_running = FALSE;
+  self->swap_pending = FALSE;
+  self->client_swapped = FALSE;
+  self->async_init = DEFAULT_ASYNC_INIT;
+  self->warmup_iterations = DEFAULT_WARMUP_ITERATIONS;
+  self->mmap_model = DEFAULT_MMAP_MODEL;
+  self->dnnl_use_arena = DEFAULT_DNNL_USE_ARENA;
+  self->xnnpack_threads = DEFAULT_XNNPACK_THREADS;
+  self->openvino_device_type = g_strdup (DEFAULT_OPENVINO_DEVICE_TYPE);
+  self->num_sessions = DEFAULT_NUM_SESSIONS;
+  self->session_threads = DEFAULT_SESSION_THREADS;
+  self->pin_session_threads = DEFAULT_PIN_SESSION_THREADS;
+  self->use_scheduler = DEFAULT_USE_SCHEDULER;
+  self->priority = DEFAULT_PRIORITY;
+  self->deadline = DEFAULT_DEADLINE;
+  self->scheduler_slots = DEFAULT_SCHEDULER_SLOTS;
+  self->scheduler_policy = DEFAULT_SCHEDULER_POLICY;
+  self->scheduler_stream = NULL;
+  g_mutex_init (&self->scheduler_lock);
+  self->stats_interval = DEFAULT_STATS_INTERVAL;
+  g_mutex_init (&self->profile_lock);
+  self->enable_profiling = DEFAULT_ENABLE_PROFILING;
+  self->profile_prefix = g_strdup (DEFAULT_PROFILE_PREFIX);
+  self->profile_frames = DEFAULT_PROFILE_FRAMES;
+  self->profiling = FALSE;
+  self->ready = FALSE;
+  self->init_failed = FALSE;
   self->score_threshold = DEFAULT_SCORE_THRESHOLD;
   self->nms_threshold = DEFAULT_NMS_THRESHOLD;
   self->optimization_level = DEFAULT_OPTIMIZATION_LEVEL;
   self->execution_provider = DEFAULT_EXECUTION_PROVIDER;
   self->detection_model = DEFAULT_DETECTION_MODEL;
   self->device_id = DEFAULT_DEVICE_ID;
+  self->tile_rows = DEFAULT_TILE_ROWS;
+  self->tile_columns = DEFAULT_TILE_COLUMNS;
+  self->tile_overlap = DEFAULT_TILE_OVERLAP;
+  self->input_size = DEFAULT_INPUT_SIZE;
+  self->inference_interval = DEFAULT_INFERENCE_INTERVAL;
+  self->adaptive_quality = DEFAULT_ADAPTIVE_QUALITY;
+  self->target_latency = DEFAULT_TARGET_LATENCY;
+  self->target_fps = DEFAULT_TARGET_FPS;
+  self->frame_count = 0;
 }
 
 static void
@@ -223,9 +593,12 @@ gst_ortobjectdetector_set_property (GObject * object, guint prop_id,
     case PROP_MODEL_FILE:
       filename = g_value_get_string(value);
       if (filename && g_file_test(filename, (GFileTest) (G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR))) {
+        GST_OBJECT_LOCK (self);
         if (self->model_file) 
           g_free(self->model_file);
         self->model_file = g_strdup(filename);
+        GST_OBJECT_UNLOCK (self);
+        gst_ortobjectdetector_request_swap (self);
       } else {
         GST_WARNING_OBJECT (self, "Model file '%s' not found!", filename);
         gst_base_transform_set_passthrough(GST_BASE_TRANSFORM (self), TRUE);
@@ -234,9 +607,12 @@ gst_ortobjectdetector_set_property (GObject * object, guint prop_id,
     case PROP_LABEL_FILE:
       filename = g_value_get_string(value);
       if (filename && g_file_test(filename, (GFileTest) (G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR))) {
+        GST_OBJECT_LOCK (self);
         if (self->label_file) 
           g_free(self->label_file);
         self->label_file = g_strdup(filename);
+        GST_OBJECT_UNLOCK (self);
+        gst_ortobjectdetector_request_swap (self);
       } else {
         GST_WARNING_OBJECT (self, "Label file '%s' not found!", filename);
         gst_base_transform_set_passthrough(GST_BASE_TRANSFORM (self), TRUE);
@@ -260,6 +636,113 @@ gst_ortobjectdetector_set_property (GObject * object, guint prop_id,
     case PROP_DEVICE_ID:
       self->device_id = g_value_get_int(value);
       break;
+    case PROP_TILE_ROWS:
+      self->tile_rows = g_value_get_int(value);
+      break;
+    case PROP_TILE_COLUMNS:
+      self->tile_columns = g_value_get_int(value);
+      break;
+    case PROP_TILE_OVERLAP:
+      self->tile_overlap = g_value_get_float(value);
+      break;
+    case PROP_INPUT_SIZE:
+      self->input_size = g_value_get_int(value);
+      break;
+    case PROP_INFERENCE_INTERVAL:
+      self->inference_interval = g_value_get_int(value);
+      break;
+    case PROP_ADAPTIVE_QUALITY:
+      self->adaptive_quality = g_value_get_boolean(value);
+      break;
+    case PROP_TARGET_LATENCY:
+      self->target_latency = g_value_get_float(value);
+      break;
+    case PROP_TARGET_FPS:
+      self->target_fps = g_value_get_float(value);
+      break;
+    case PROP_CACHE_DIR:
+      GST_OBJECT_LOCK (self);
+      g_free(self->cache_dir);
+      self->cache_dir = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_ASYNC_INIT:
+      self->async_init = g_value_get_boolean(value);
+      break;
+    case PROP_WARMUP_ITERATIONS:
+      self->warmup_iterations = g_value_get_int(value);
+      break;
+    case PROP_MMAP_MODEL:
+      self->mmap_model = g_value_get_boolean(value);
+      break;
+    case PROP_DNNL_USE_ARENA:
+      self->dnnl_use_arena = g_value_get_boolean(value);
+      break;
+    case PROP_XNNPACK_THREADS:
+      self->xnnpack_threads = g_value_get_int(value);
+      break;
+    case PROP_OPENVINO_DEVICE_TYPE:
+      GST_OBJECT_LOCK (self);
+      g_free(self->openvino_device_type);
+      self->openvino_device_type = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_NUM_SESSIONS:
+      self->num_sessions = g_value_get_int(value);
+      break;
+    case PROP_SESSION_THREADS:
+      self->session_threads = g_value_get_int(value);
+      break;
+    case PROP_PIN_SESSION_THREADS:
+      self->pin_session_threads = g_value_get_boolean(value);
+      break;
+    case PROP_USE_SCHEDULER:
+      self->use_scheduler = g_value_get_boolean(value);
+      break;
+    case PROP_PRIORITY:
+      self->priority = g_value_get_int(value);
+      g_mutex_lock (&self->scheduler_lock);
+      if (self->scheduler_stream) {
+        InferenceScheduler::Get().SetPriority(self->scheduler_stream, self->priority);
+      }
+      g_mutex_unlock (&self->scheduler_lock);
+      break;
+    case PROP_DEADLINE:
+      self->deadline = g_value_get_float(value);
+      break;
+    case PROP_SCHEDULER_SLOTS:
+      self->scheduler_slots = g_value_get_int(value);
+      break;
+    case PROP_SCHEDULER_POLICY:
+      self->scheduler_policy = (GstOrtSchedulerPolicy) g_value_get_enum(value);
+      break;
+    case PROP_DAEMON_SOCKET:
+      GST_OBJECT_LOCK (self);
+      g_free(self->daemon_socket);
+      self->daemon_socket = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_float(value);
+      break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (self);
+      g_free(self->trace_file);
+      self->trace_file = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_ENABLE_PROFILING:
+      self->enable_profiling = g_value_get_boolean(value);
+      break;
+    case PROP_PROFILE_PREFIX:
+      GST_OBJECT_LOCK (self);
+      g_free(self->profile_prefix);
+      self->profile_prefix = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_PROFILE_FRAMES:
+      self->profile_frames = g_value_get_uint(value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -274,10 +757,14 @@ gst_ortobjectdetector_get_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_MODEL_FILE:
+      GST_OBJECT_LOCK (self);
       g_value_set_string(value, self->model_file);
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_LABEL_FILE:
+      GST_OBJECT_LOCK (self);
       g_value_set_string(value, self->label_file);
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_SCORE_THRESHOLD:
       g_value_set_float(value, self->score_threshold);
@@ -297,6 +784,121 @@ gst_ortobjectdetector_get_property (GObject * object, guint prop_id,
     case PROP_DEVICE_ID:
       g_value_set_int(value, self->device_id);
       break;
+    case PROP_TILE_ROWS:
+      g_value_set_int(value, self->tile_rows);
+      break;
+    case PROP_TILE_COLUMNS:
+      g_value_set_int(value, self->tile_columns);
+      break;
+    case PROP_TILE_OVERLAP:
+      g_value_set_float(value, self->tile_overlap);
+      break;
+    case PROP_INPUT_SIZE:
+      g_value_set_int(value, self->input_size);
+      break;
+    case PROP_INFERENCE_INTERVAL:
+      g_value_set_int(value, self->inference_interval);
+      break;
+    case PROP_ADAPTIVE_QUALITY:
+      g_value_set_boolean(value, self->adaptive_quality);
+      break;
+    case PROP_TARGET_LATENCY:
+      g_value_set_float(value, self->target_latency);
+      break;
+    case PROP_TARGET_FPS:
+      g_value_set_float(value, self->target_fps);
+      break;
+    case PROP_CACHE_DIR:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string(value, self->cache_dir);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_ASYNC_INIT:
+      g_value_set_boolean(value, self->async_init);
+      break;
+    case PROP_WARMUP_ITERATIONS:
+      g_value_set_int(value, self->warmup_iterations);
+      break;
+    case PROP_MMAP_MODEL:
+      g_value_set_boolean(value, self->mmap_model);
+      break;
+    case PROP_DNNL_USE_ARENA:
+      g_value_set_boolean(value, self->dnnl_use_arena);
+      break;
+    case PROP_XNNPACK_THREADS:
+      g_value_set_int(value, self->xnnpack_threads);
+      break;
+    case PROP_OPENVINO_DEVICE_TYPE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string(value, self->openvino_device_type);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_NUM_SESSIONS:
+      g_value_set_int(value, self->num_sessions);
+      break;
+    case PROP_SESSION_THREADS:
+      g_value_set_int(value, self->session_threads);
+      break;
+    case PROP_PIN_SESSION_THREADS:
+      g_value_set_boolean(value, self->pin_session_threads);
+      break;
+    case PROP_USE_SCHEDULER:
+      g_value_set_boolean(value, self->use_scheduler);
+      break;
+    case PROP_PRIORITY:
+      g_value_set_int(value, self->priority);
+      break;
+    case PROP_DEADLINE:
+      g_value_set_float(value, self->deadline);
+      break;
+    case PROP_SCHEDULER_SLOTS:
+      g_value_set_int(value, self->scheduler_slots);
+      break;
+    case PROP_SCHEDULER_POLICY:
+      g_value_set_enum(value, self->scheduler_policy);
+      break;
+    case PROP_FRAMES_SERVED:
+      g_value_set_uint64(value, self->frames_served);
+      break;
+    case PROP_FRAMES_DROPPED:
+      g_value_set_uint64(value, self->frames_dropped);
+      break;
+    case PROP_DAEMON_SOCKET:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string(value, self->daemon_socket);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_FRAMES:
+      g_value_set_uint64(value, self->stats->GetFrames());
+      break;
+    case PROP_DETECTIONS:
+      g_value_set_uint64(value, self->stats->GetDetections());
+      break;
+    case PROP_FRAMES_SKIPPED:
+      g_value_set_uint64(value, self->stats->GetSkipped());
+      break;
+    case PROP_STATS:
+      g_value_take_boxed(value, gst_ortobjectdetector_get_stats (self));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_float(value, self->stats_interval);
+      break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string(value, self->trace_file);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_ENABLE_PROFILING:
+      g_value_set_boolean(value, self->enable_profiling);
+      break;
+    case PROP_PROFILE_PREFIX:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string(value, self->profile_prefix);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_PROFILE_FRAMES:
+      g_value_set_uint(value, self->profile_frames);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -307,81 +909,869 @@ static void
 gst_ortobjectdetector_finalize (GObject * object)
 {
   Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (object);
+  // Normally joined on stop; background setup must not outlive the element
+  if (self->init_thread) {
+    g_thread_join (self->init_thread);
+  }
+  if (self->swap_thread) {
+    g_thread_join (self->swap_thread);
+  }
   g_free (self->model_file);
   g_free (self->label_file);
+  g_free (self->cache_dir);
+  g_free (self->openvino_device_type);
+  g_free (self->daemon_socket);
+  g_free (self->trace_file);
+  g_free (self->profile_prefix);
+  // Destroy C++ members constructed in init
+  self->ort_client.~shared_ptr ();
+  self->daemon_client.~shared_ptr ();
+  self->governor.~unique_ptr ();
+  self->frames_served.~atomic ();
+  self->frames_dropped.~atomic ();
+  self->stats.~unique_ptr ();
+  self->last_stats_post.~atomic ();
+  self->trace_writer.~unique_ptr ();
+  self->profiled_frames.~atomic ();
+  self->profiles.~vector ();
+  g_mutex_clear (&self->setup_lock);
+  g_mutex_clear (&self->client_lock);
+  g_cond_clear (&self->client_cond);
+  g_mutex_clear (&self->quality_lock);
+  g_mutex_clear (&self->resize_lock);
+  g_mutex_clear (&self->frame_lock);
+  g_mutex_clear (&self->profile_lock);
+  g_mutex_clear (&self->scheduler_lock);
+  g_cond_clear (&self->frame_cond);
   G_OBJECT_CLASS (gst_ortobjectdetector_parent_class)->finalize (object);
 }
 
-static gboolean
-gst_ortobjectdetector_ort_setup (GstBaseTransform *base) {
-  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
-  std::unique_ptr<OrtClient>& ort_client = self->ort_client;
-  
+/* Reference to the current client held while using it, e.g. for a frame. It is
+ * taken and released under client_lock, so that the reference count of a
+ * swapped out client is exact while the swap thread waits for its last user.
+ */
+class GstOrtClientRef {
+  public:
+    explicit GstOrtClientRef (Gstortobjectdetector *self) : self (self) {
+      g_mutex_lock (&self->client_lock);
+      client = self->ort_client;
+      g_mutex_unlock (&self->client_lock);
+    }
+
+    ~GstOrtClientRef () {
+      g_mutex_lock (&self->client_lock);
+      client.reset ();
+      g_cond_broadcast (&self->client_cond);
+      g_mutex_unlock (&self->client_lock);
+    }
+
+    std::shared_ptr<OrtClient> const& Get () const {
+      return client;
+    }
+
+  private:
+    Gstortobjectdetector *self;
+    std::shared_ptr<OrtClient> client;
+};
+
+/* Create and initialize a new ORT client from the current properties, with
+ * its sessions profiled if profile is set.
+ * Returns an empty pointer if initialization failed.
+ */
+static std::shared_ptr<OrtClient>
+gst_ortobjectdetector_create_client (Gstortobjectdetector *self, gboolean profile) {
+  // Snapshot file properties, as they may be replaced while a session is created
   GST_OBJECT_LOCK (self);
-  if (ort_client->IsInitialized()) {
-    GST_OBJECT_UNLOCK (self);
-    return TRUE;
+  gchar *model_file = g_strdup (self->model_file);
+  gchar *label_file = g_strdup (self->label_file);
+  gchar *cache_dir = g_strdup (self->cache_dir);
+  gchar *profile_prefix = g_strdup (self->profile_prefix);
+  ProviderOptions provider_options;
+  provider_options.dnnl_use_arena = self->dnnl_use_arena;
+  provider_options.xnnpack_threads = self->xnnpack_threads;
+  if (self->openvino_device_type) {
+    provider_options.openvino_device_type = self->openvino_device_type;
   }
+  GST_OBJECT_UNLOCK (self);
 
-  if (!self->model_file || !self->label_file) {
-    GST_OBJECT_UNLOCK (self);
+  std::shared_ptr<OrtClient> ort_client;
+  if (!model_file || !label_file) {
     GST_ERROR_OBJECT (self, "Unable to initialize ORT client without model and/or label file!");
-    return FALSE;
+    goto done;
   }
 
-  GST_INFO_OBJECT (self, "model-file: %s\n", self->model_file);
-  GST_INFO_OBJECT (self, "label-file: %s\n", self->label_file);
+  GST_INFO_OBJECT (self, "model-file: %s\n", model_file);
+  GST_INFO_OBJECT (self, "label-file: %s\n", label_file);
   GST_INFO_OBJECT (self, "score-threshold: %f\n", self->score_threshold);
   GST_INFO_OBJECT (self, "nms-threshold: %f\n", self->nms_threshold);
   GST_INFO_OBJECT (self, "optimization-level: %d\n", self->optimization_level);
   GST_INFO_OBJECT (self, "execution-provider: %d\n", self->execution_provider);
   GST_INFO_OBJECT (self, "detection-model: %d\n", self->detection_model);
   GST_INFO_OBJECT (self, "device-id: %d\n", self->device_id);
+  GST_INFO_OBJECT (self, "tiles: %dx%d (overlap %f)\n", self->tile_columns, self->tile_rows, self->tile_overlap);
+  GST_INFO_OBJECT (self, "input-size: %d\n", self->input_size);
+  GST_INFO_OBJECT (self, "sessions: %d (%d threads each%s)\n", self->num_sessions, self->session_threads, self->pin_session_threads ? ", pinned" : "");
   GST_INFO_OBJECT (self, "Initializing ORT client...\n");
-  gboolean res = ort_client->Init(self->model_file, self->label_file, self->optimization_level, self->execution_provider, self->detection_model, self->device_id);
-  GST_INFO_OBJECT (self, "Initialized: %s\n", res ? "true" : "false");
+  ort_client = std::make_shared<OrtClient>();
+  ort_client->SetTiling(self->tile_rows, self->tile_columns, self->tile_overlap);
+  ort_client->SetInputSize(self->input_size);
+  ort_client->SetMemoryMapModel(self->mmap_model);
+  ort_client->SetProviderOptions(provider_options);
+  ort_client->SetSessionPool(self->num_sessions, self->session_threads, self->pin_session_threads);
+  if (cache_dir) {
+    GST_INFO_OBJECT (self, "cache-dir: %s\n", cache_dir);
+    ort_client->SetCacheDir(cache_dir);
+  }
+  if (profile && profile_prefix) {
+    GST_INFO_OBJECT (self, "profile-prefix: %s\n", profile_prefix);
+    ort_client->SetProfiling(profile_prefix);
+  }
+  {
+    gboolean res = ort_client->Init(model_file, label_file, self->optimization_level, self->execution_provider, self->detection_model, self->device_id);
+    GST_INFO_OBJECT (self, "Initialized: %s\n", res ? "true" : "false");
+    if (res && self->warmup_iterations > 0) {
+      GST_INFO_OBJECT (self, "Running %d warm-up inferences...\n", self->warmup_iterations);
+      res = ort_client->Warmup(self->warmup_iterations);
+    }
+    if (!res) {
+      ort_client.reset();
+    }
+  }
+
+done:
+  g_free (model_file);
+  g_free (label_file);
+  g_free (cache_dir);
+  g_free (profile_prefix);
+  return ort_client;
+}
+
+/* (Re)configure quality governor for the given client */
+static void
+gst_ortobjectdetector_configure_quality (Gstortobjectdetector *self, std::shared_ptr<OrtClient> const& ort_client) {
+  if (!self->adaptive_quality) {
+    return;
+  }
+  double budget_ms = self->target_latency > 0 ? self->target_latency : (self->target_fps > 0 ? 1000.0 / self->target_fps : 0);
+  GST_INFO_OBJECT (self, "adaptive-quality budget: %f ms\n", budget_ms);
+  // Input size is the daemon's to choose when there is no in-process client
+  gint input_size = ort_client ? ort_client->GetInputSize() : 0;
+  gboolean dynamic_input_size = ort_client && ort_client->HasDynamicInputSize();
+  g_mutex_lock (&self->quality_lock);
+  self->governor->Configure(budget_ms, self->inference_interval, input_size, dynamic_input_size);
+  g_mutex_unlock (&self->quality_lock);
+}
+
+/* End profiling of a client's sessions, keeping their profiles for the summary
+ * on stop. Only the first call after a profiled client was set up has an effect.
+ */
+static void
+gst_ortobjectdetector_end_profiling (Gstortobjectdetector *self, std::shared_ptr<OrtClient> const& ort_client) {
+  if (!ort_client || !g_atomic_int_compare_and_exchange (&self->profiling, TRUE, FALSE)) {
+    return;
+  }
+  std::vector<SessionProfile> profiles = ort_client->EndProfiling();
+  g_mutex_lock (&self->profile_lock);
+  self->profiles.insert (self->profiles.end (), profiles.begin (), profiles.end ());
+  g_mutex_unlock (&self->profile_lock);
+  GST_INFO_OBJECT (self, "Ended ORT profiling after %" G_GUINT64_FORMAT " frames", (guint64) self->profiled_frames);
+}
+
+static gboolean
+gst_ortobjectdetector_ort_setup (GstBaseTransform *base) {
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+  
+  g_mutex_lock (&self->setup_lock);
+  if (g_atomic_int_get (&self->ready)) {
+    g_mutex_unlock (&self->setup_lock);
+    return TRUE;
+  }
+
+  GST_OBJECT_LOCK (self);
+  gchar *daemon_socket = g_strdup (self->daemon_socket);
   GST_OBJECT_UNLOCK (self);
+
+  gboolean res;
+  if (daemon_socket) {
+    GST_INFO_OBJECT (self, "daemon-socket: %s\n", daemon_socket);
+    // One slot per frame that may be in flight at a time
+    std::shared_ptr<OrtDaemonClient> daemon_client = std::make_shared<OrtDaemonClient>(self->num_sessions);
+    res = daemon_client->Init(daemon_socket);
+    if (res) {
+      gst_ortobjectdetector_configure_quality (self, nullptr);
+      self->daemon_client = daemon_client;
+    }
+    g_free (daemon_socket);
+  } else {
+    GST_OBJECT_LOCK (self);
+    gboolean profile = self->enable_profiling;
+    GST_OBJECT_UNLOCK (self);
+    std::shared_ptr<OrtClient> ort_client = gst_ortobjectdetector_create_client (self, profile);
+    res = ort_client != nullptr;
+    if (res) {
+      self->profiled_frames = 0;
+      g_atomic_int_set (&self->profiling, profile);
+      gst_ortobjectdetector_configure_quality (self, ort_client);
+      g_mutex_lock (&self->client_lock);
+      self->ort_client = ort_client;
+      g_mutex_unlock (&self->client_lock);
+    }
+  }
+  g_atomic_int_set (&self->ready, res);
+  g_atomic_int_set (&self->init_failed, !res);
+  g_mutex_unlock (&self->setup_lock);
   return res;
 }
 
-/* GstBaseTransform vmethod implementations */
+/* Background thread body for model hot-swap. Builds and warms up a new client
+ * while the current one keeps serving, then swaps it in between frames. The old
+ * client is destroyed on this thread once in-flight frames have released it, so
+ * that its teardown never stalls a frame. Repeats if the model/label file
+ * changed again in the meantime.
+ */
+static gpointer
+gst_ortobjectdetector_swap_thread (gpointer data) {
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (data);
 
-/* this function does the actual processing (IP = in place)
+  g_mutex_lock (&self->setup_lock);
+  while (TRUE) {
+    self->swap_pending = FALSE;
+    g_mutex_unlock (&self->setup_lock);
+
+    std::shared_ptr<OrtClient> ort_client = gst_ortobjectdetector_create_client (self, FALSE);
+    if (ort_client) {
+      g_mutex_lock (&self->client_lock);
+      self->ort_client.swap (ort_client);
+      g_mutex_unlock (&self->client_lock);
+      g_atomic_int_set (&self->client_swapped, TRUE);
+      GST_INFO_OBJECT (self, "Swapped in new ORT client");
+      // Only the client created on start is profiled; keep what it recorded
+      gst_ortobjectdetector_end_profiling (self, ort_client);
+      // ort_client now holds the old client; wait for in-flight frames to release it
+      g_mutex_lock (&self->client_lock);
+      while (ort_client.use_count () > 1) {
+        g_cond_wait (&self->client_cond, &self->client_lock);
+      }
+      g_mutex_unlock (&self->client_lock);
+      ort_client.reset ();
+    } else {
+      GST_ELEMENT_WARNING (self, RESOURCE, FAILED, ("Unable to load new model, keeping current model"), (NULL));
+    }
+
+    g_mutex_lock (&self->setup_lock);
+    if (!self->swap_pending) {
+      self->swap_running = FALSE;
+      break;
+    }
+  }
+  g_mutex_unlock (&self->setup_lock);
+  return NULL;
+}
+
+/* Start (or queue) a hot-swap of the ORT client after a model/label file change */
+static void
+gst_ortobjectdetector_request_swap (Gstortobjectdetector *self) {
+  g_mutex_lock (&self->setup_lock);
+  if (!self->started) {
+    // Not running: drop the client so that the next start loads the new files
+    g_atomic_int_set (&self->ready, FALSE);
+    g_mutex_lock (&self->client_lock);
+    self->ort_client.reset ();
+    g_mutex_unlock (&self->client_lock);
+    g_mutex_unlock (&self->setup_lock);
+    return;
+  }
+  if (!g_atomic_int_get (&self->ready) || self->daemon_client) {
+    // Not serving yet: new files are picked up by initial setup.
+    // With a daemon, the model is the daemon's.
+    g_mutex_unlock (&self->setup_lock);
+    return;
+  }
+  if (self->swap_running) {
+    self->swap_pending = TRUE;
+  } else {
+    if (self->swap_thread) {
+      g_thread_join (self->swap_thread);
+    }
+    self->swap_running = TRUE;
+    self->swap_thread = g_thread_new ("ortobjectdetector-swap", gst_ortobjectdetector_swap_thread, self);
+  }
+  g_mutex_unlock (&self->setup_lock);
+}
+
+/* Background thread body for async-init */
+static gpointer
+gst_ortobjectdetector_init_thread (gpointer data) {
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (data);
+  if (!gst_ortobjectdetector_ort_setup (GST_BASE_TRANSFORM (self))) {
+    GST_ELEMENT_ERROR (self, RESOURCE, FAILED, ("Unable to initialize ORT client"), (NULL));
+  }
+  return NULL;
+}
+
+/* Feed inference latency to quality governor, applying and reporting any level change.
+ * May be called from several frame pool threads at once.
+ */
+static void
+gst_ortobjectdetector_update_quality (Gstortobjectdetector *self, std::shared_ptr<OrtClient> const& ort_client, double latency_ms) {
+  std::unique_ptr<QualityGovernor>& governor = self->governor;
+  g_mutex_lock (&self->quality_lock);
+  if (!governor->Update(latency_ms)) {
+    g_mutex_unlock (&self->quality_lock);
+    return;
+  }
+  QualityLevel level = governor->GetLevel();
+  guint level_index = governor->GetLevelIndex();
+  g_mutex_unlock (&self->quality_lock);
+  // Resizing waits for in-flight inferences, so it is done outside quality_lock
+  // to keep frames being prepared meanwhile. Concurrent resizes are ordered, and
+  // each applies the governor's latest level.
+  if (ort_client && level.input_size > 0) {
+    g_mutex_lock (&self->resize_lock);
+    g_mutex_lock (&self->quality_lock);
+    gint target_size = governor->GetLevel().input_size;
+    g_mutex_unlock (&self->quality_lock);
+    if (target_size > 0 && target_size != ort_client->GetInputSize() && !ort_client->SetInputSize(target_size)) {
+      GST_WARNING_OBJECT (self, "Unable to change input size to %d", target_size);
+    }
+    g_mutex_unlock (&self->resize_lock);
+  }
+  gint input_size = ort_client ? ort_client->GetInputSize() : 0;
+  GST_INFO_OBJECT (self, "Quality level changed to %u (latency %f ms)", level_index, latency_ms);
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self),
+          gst_structure_new ("ortobjectdetector-quality",
+              "level", G_TYPE_UINT, level_index,
+              "inference-interval", G_TYPE_INT, level.inference_interval,
+              "score-threshold", G_TYPE_FLOAT, MIN (self->score_threshold + level.score_threshold_boost, 1.0f),
+              "input-size", G_TYPE_INT, input_size,
+              "latency", G_TYPE_DOUBLE, latency_ms,
+              NULL)));
+}
+
+/* Snapshot of frame counters and per-stage timing statistics */
+static GstStructure *
+gst_ortobjectdetector_get_stats (Gstortobjectdetector *self) {
+  StageStats& stats = *self->stats;
+  GstStructure *structure = gst_structure_new ("ortobjectdetector-stats",
+      "frames", G_TYPE_UINT64, stats.GetFrames(),
+      "detections", G_TYPE_UINT64, stats.GetDetections(),
+      "frames-skipped", G_TYPE_UINT64, stats.GetSkipped(),
+      NULL);
+  for (int i = 0; i < INFERENCE_STAGE_COUNT; i++) {
+    InferenceStage stage = (InferenceStage) i;
+    StageSummary summary = stats.GetSummary(stage);
+    const gchar *name = StageStats::GetStageName(stage);
+    gchar *mean = g_strdup_printf ("%s-mean", name);
+    gchar *p50 = g_strdup_printf ("%s-p50", name);
+    gchar *p95 = g_strdup_printf ("%s-p95", name);
+    gchar *p99 = g_strdup_printf ("%s-p99", name);
+    gst_structure_set (structure,
+        mean, G_TYPE_DOUBLE, summary.mean_ms,
+        p50, G_TYPE_DOUBLE, summary.p50_ms,
+        p95, G_TYPE_DOUBLE, summary.p95_ms,
+        p99, G_TYPE_DOUBLE, summary.p99_ms,
+        NULL);
+    g_free (mean);
+    g_free (p50);
+    g_free (p95);
+    g_free (p99);
+  }
+  return structure;
+}
+
+/* Post statistics on the bus if stats-interval has elapsed since they were last
+ * posted. May be called from several frame pool threads at once; one posts.
+ */
+static void
+gst_ortobjectdetector_post_stats (Gstortobjectdetector *self) {
+  if (self->stats_interval <= 0) {
+    return;
+  }
+  gint64 now = g_get_monotonic_time ();
+  gint64 last = self->last_stats_post;
+  if (now - last < (gint64) (self->stats_interval * 1000) || !self->last_stats_post.compare_exchange_strong (last, now)) {
+    return;
+  }
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), gst_ortobjectdetector_get_stats (self)));
+}
+
+/* Create the trace file when starting, if trace-file is set */
+static void
+gst_ortobjectdetector_open_trace (Gstortobjectdetector *self) {
+  GST_OBJECT_LOCK (self);
+  gchar *trace_file = g_strdup (self->trace_file);
+  GST_OBJECT_UNLOCK (self);
+  if (!trace_file) {
+    return;
+  }
+  const gchar *process_name = g_get_prgname () ? g_get_prgname () : "gstreamer";
+  std::unique_ptr<TraceWriter> trace_writer (new TraceWriter ());
+  if (trace_writer->Open(trace_file, process_name, GST_OBJECT_NAME (self))) {
+    GST_INFO_OBJECT (self, "trace-file: %s\n", trace_file);
+    self->trace_writer = std::move (trace_writer);
+  } else {
+    GST_ELEMENT_WARNING (self, RESOURCE, OPEN_WRITE, ("Unable to create trace file %s", trace_file), (NULL));
+  }
+  g_free (trace_file);
+}
+
+/* Log kernel time per operator type and execution provider */
+static void
+gst_ortobjectdetector_log_profile (Gstortobjectdetector *self, std::vector<OrtProfileEvent> const& events) {
+  OrtProfileSummary summary;
+  SummarizeOrtProfile(events, summary);
+  double kernel_us = 0;
+  for (OrtOperatorCost const& cost : summary.operators) {
+    kernel_us += cost.total_us;
+  }
+  guint64 runs = MAX (summary.runs, 1);
+  GST_INFO_OBJECT (self, "ORT profile: %" G_GUINT64_FORMAT " runs, %.3f ms per run, %.3f ms in kernels per run",
+      summary.runs, summary.run_us / runs / 1000.0, kernel_us / runs / 1000.0);
+  GST_INFO_OBJECT (self, "%-24s %-28s %10s %12s %12s %7s", "operator", "provider", "calls", "total ms", "ms per run", "share");
+  for (OrtOperatorCost const& cost : summary.operators) {
+    GST_INFO_OBJECT (self, "%-24s %-28s %10" G_GUINT64_FORMAT " %12.3f %12.3f %6.1f%%",
+        cost.op_name.c_str(), cost.provider.c_str(), cost.calls, cost.total_us / 1000.0,
+        cost.total_us / runs / 1000.0, kernel_us > 0 ? 100.0 * cost.total_us / kernel_us : 0.0);
+  }
+}
+
+/* End profiling if still running, then merge the collected ORT profiles into
+ * the trace (if tracing) and log their per-operator summary
+ */
+static void
+gst_ortobjectdetector_finish_profiling (Gstortobjectdetector *self) {
+  {
+    GstOrtClientRef client_ref (self);
+    gst_ortobjectdetector_end_profiling (self, client_ref.Get ());
+  }
+
+  std::vector<SessionProfile> profiles;
+  g_mutex_lock (&self->profile_lock);
+  profiles.swap (self->profiles);
+  g_mutex_unlock (&self->profile_lock);
+  if (profiles.empty ()) {
+    return;
+  }
+  // ORT times events from its profiling start on the system clock, spans use the monotonic clock
+  gint64 clock_offset = g_get_monotonic_time () - g_get_real_time ();
+  std::vector<OrtProfileEvent> all_events;
+  for (SessionProfile const& profile : profiles) {
+    std::vector<OrtProfileEvent> events;
+    if (!ReadOrtProfile(profile.path, events)) {
+      GST_WARNING_OBJECT (self, "Unable to read ORT profile %s", profile.path.c_str());
+      continue;
+    }
+    GST_INFO_OBJECT (self, "ORT profile written to %s", profile.path.c_str());
+    if (self->trace_writer) {
+      self->trace_writer->MergeOrtProfile(events, (gint64) (profile.start_ns / 1000) + clock_offset);
+    }
+    all_events.insert (all_events.end (), events.begin (), events.end ());
+  }
+  gst_ortobjectdetector_log_profile (self, all_events);
+}
+
+/* Complete the trace file */
+static void
+gst_ortobjectdetector_close_trace (Gstortobjectdetector *self) {
+  if (!self->trace_writer) {
+    return;
+  }
+  guint64 dropped = self->trace_writer->GetDropped();
+  if (dropped > 0) {
+    GST_WARNING_OBJECT (self, "%" G_GUINT64_FORMAT " trace spans were dropped", dropped);
+  }
+  if (!self->trace_writer->Close()) {
+    GST_WARNING_OBJECT (self, "Unable to write trace file");
+  }
+  self->trace_writer.reset ();
+}
+
+/* Record an inferenced frame as a span, with its stages as spans within it at
+ * the times they ran. Gaps between stages are waits (e.g. for a session, or
+ * for the daemon).
+ */
+static void
+gst_ortobjectdetector_trace_frame (Gstortobjectdetector *self, GstBuffer *buf, DetectionTimings const& timings, gint64 start, gint64 latency) {
+  TraceWriter& trace_writer = *self->trace_writer;
+  guint64 pts = GST_BUFFER_PTS_IS_VALID (buf) ? GST_BUFFER_PTS (buf) : TRACE_SPAN_NO_PTS;
+  trace_writer.Record("inference", pts, start, latency);
+  double stage_us[] = {timings.preprocess_us, timings.run_us, timings.postprocess_us, timings.draw_us};
+  int64_t stage_start_us[] = {timings.preprocess_start_us, timings.run_start_us, timings.postprocess_start_us, timings.draw_start_us};
+  for (int i = INFERENCE_STAGE_PREPROCESS; i <= INFERENCE_STAGE_DRAW; i++) {
+    if (stage_start_us[i] > 0) {
+      trace_writer.Record(StageStats::GetStageName((InferenceStage) i), pts, stage_start_us[i], (gint64) stage_us[i]);
+    }
+  }
+}
+
+/* Frame queued for inference on the frame pool (num-sessions > 1) */
+typedef struct {
+  GstBuffer *buffer;
+  gboolean infer;
+  gfloat score_threshold;
+  gint64 deadline;
+  gboolean done;
+  GstFlowReturn ret;
+} GstOrtFrameJob;
+
+/* Prepare a frame on the streaming thread: ensures the session is ready, and
+ * decides whether the frame is inferenced (with which score threshold, and by
+ * which scheduler deadline). Frames must be prepared in stream order, as this
+ * advances the inference interval.
  */
 static GstFlowReturn
-gst_ortobjectdetector_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
+gst_ortobjectdetector_prepare_frame (Gstortobjectdetector *self, GstBuffer *buf, gboolean *infer, gfloat *score_threshold, gint64 *deadline)
 {
-  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
-  std::unique_ptr<OrtClient>& ort_client = self->ort_client;
+  GstBaseTransform *base = GST_BASE_TRANSFORM (self);
 
-  if (!gst_ortobjectdetector_ort_setup(base)) {
-    return GST_FLOW_ERROR;
+  *infer = FALSE;
+  if (!g_atomic_int_get (&self->ready)) {
+    if (g_atomic_int_get (&self->init_failed)) {
+      return GST_FLOW_ERROR;
+    }
+    // Pass frames through unmodified while session is created in the background
+    if (self->async_init) {
+      return GST_FLOW_OK;
+    }
+    if (!gst_ortobjectdetector_ort_setup(base)) {
+      return GST_FLOW_ERROR;
+    }
   }
 
-  if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (outbuf)))
-    gst_object_sync_values (GST_OBJECT (self), GST_BUFFER_TIMESTAMP (outbuf));
+  if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (buf)))
+    gst_object_sync_values (GST_OBJECT (self), GST_BUFFER_TIMESTAMP (buf));
 
   if (gst_base_transform_is_passthrough(base)) {
     return GST_FLOW_OK;
   }
 
+  if (g_atomic_int_compare_and_exchange (&self->client_swapped, TRUE, FALSE)) {
+    GstOrtClientRef client_ref (self);
+    gst_ortobjectdetector_configure_quality (self, client_ref.Get ());
+  }
+
+  gint inference_interval = self->inference_interval;
+  *score_threshold = self->score_threshold;
+  if (self->adaptive_quality) {
+    g_mutex_lock (&self->quality_lock);
+    QualityLevel const& level = self->governor->GetLevel();
+    inference_interval = level.inference_interval;
+    *score_threshold = MIN (*score_threshold + level.score_threshold_boost, 1.0f);
+    g_mutex_unlock (&self->quality_lock);
+  }
+  // Skip inference on frames in between inference intervals
+  *infer = self->frame_count++ % inference_interval == 0;
+  *deadline = self->deadline > 0 ? InferenceScheduler::Now() + (gint64) (self->deadline * 1000) : 0;
+  return GST_FLOW_OK;
+}
+
+/* Run inference on a prepared frame, modifying it in place.
+ * Called on the streaming thread, or on a frame pool thread.
+ */
+static GstFlowReturn
+gst_ortobjectdetector_infer_frame (Gstortobjectdetector *self, GstBuffer *buf, gfloat score_threshold, gint64 deadline)
+{
   GstMapInfo info;
-  GstVideoMeta *vmeta = gst_buffer_get_video_meta(outbuf);
+  GstVideoMeta *vmeta = gst_buffer_get_video_meta(buf);
 
   if (!vmeta) {
-    GST_WARNING_OBJECT (base, "missing video meta");
+    GST_WARNING_OBJECT (self, "missing video meta");
     return GST_FLOW_ERROR;
   }
 
-  if (gst_buffer_map(outbuf, &info, GST_MAP_READWRITE)) {
+  // Hold a reference to the current client, so that a hot-swap never releases it mid-frame
+  GstOrtClientRef client_ref (self);
+  std::shared_ptr<OrtClient> const& ort_client = client_ref.Get ();
+
+  SchedulerStream *stream = self->scheduler_stream;
+  gint64 wait_start = g_get_monotonic_time ();
+  gboolean acquired = !stream || InferenceScheduler::Get().Acquire(stream, deadline);
+  if (stream && self->trace_writer) {
+    self->trace_writer->Record("scheduler-wait", GST_BUFFER_PTS_IS_VALID (buf) ? GST_BUFFER_PTS (buf) : TRACE_SPAN_NO_PTS, wait_start, g_get_monotonic_time () - wait_start);
+  }
+  if (!acquired) {
+    GST_LOG_OBJECT (self, "Shedding frame that cannot meet its deadline");
+    self->frames_dropped++;
+    self->stats->AddSkipped();
+    gst_ortobjectdetector_post_stats (self);
+    return GST_FLOW_OK;
+  }
+
+  if (gst_buffer_map(buf, &info, GST_MAP_READWRITE)) {
     // Modify frame in place
-    ort_client->RunModel(info.data, vmeta, self->score_threshold, self->nms_threshold);
-    gst_buffer_unmap (outbuf, &info);
+    DetectionTimings timings;
+    size_t num_detections;
+    gint64 start = g_get_monotonic_time ();
+    if (self->daemon_client) {
+      num_detections = self->daemon_client->RunModel(info.data, vmeta, score_threshold, self->nms_threshold, &timings);
+    } else {
+      num_detections = ort_client->RunModel(info.data, vmeta, score_threshold, self->nms_threshold, &timings);
+    }
+    gint64 latency = g_get_monotonic_time () - start;
+    self->stats->AddFrame(timings, latency, num_detections);
+    gst_ort_stats_trace_frame (GST_ELEMENT (self), timings, latency);
+    if (self->trace_writer) {
+      gst_ortobjectdetector_trace_frame (self, buf, timings, start, latency);
+    }
+    gst_buffer_unmap (buf, &info);
+    if (stream) {
+      InferenceScheduler::Get().Release(stream, latency);
+    }
+    self->frames_served++;
+    if (self->adaptive_quality) {
+      gst_ortobjectdetector_update_quality (self, ort_client, latency / 1000.0);
+    }
+    gst_ortobjectdetector_post_stats (self);
+    if (g_atomic_int_get (&self->profiling) && self->profile_frames > 0 && ++self->profiled_frames == self->profile_frames) {
+      gst_ortobjectdetector_end_profiling (self, ort_client);
+    }
+  } else if (stream) {
+    InferenceScheduler::Get().Release(stream, 0);
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Frame pool thread body */
+static void
+gst_ortobjectdetector_frame_worker (gpointer data, gpointer user_data)
+{
+  GstOrtFrameJob *job = (GstOrtFrameJob *) data;
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (user_data);
+
+  GstFlowReturn ret = gst_ortobjectdetector_infer_frame (self, job->buffer, job->score_threshold, job->deadline);
+  g_mutex_lock (&self->frame_lock);
+  job->ret = ret;
+  job->done = TRUE;
+  g_cond_broadcast (&self->frame_cond);
+  g_mutex_unlock (&self->frame_lock);
+}
+
+/* Wait for all queued frames, pushing them downstream in order (or dropping
+ * them if discard is set). Called on the streaming thread, or when stopping.
+ */
+static GstFlowReturn
+gst_ortobjectdetector_drain (Gstortobjectdetector *self, gboolean discard)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstOrtFrameJob *job;
+
+  g_mutex_lock (&self->frame_lock);
+  while ((job = (GstOrtFrameJob *) g_queue_pop_head (&self->frame_queue)) != NULL) {
+    while (!job->done) {
+      g_cond_wait (&self->frame_cond, &self->frame_lock);
+    }
+    g_mutex_unlock (&self->frame_lock);
+    if (!discard && ret == GST_FLOW_OK && job->ret == GST_FLOW_OK) {
+      ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (self), job->buffer);
+    } else {
+      gst_buffer_unref (job->buffer);
+      if (ret == GST_FLOW_OK) {
+        ret = job->ret;
+      }
+    }
+    g_free (job);
+    g_mutex_lock (&self->frame_lock);
+  }
+  g_mutex_unlock (&self->frame_lock);
+  return discard ? GST_FLOW_OK : ret;
+}
+
+/* GstBaseTransform vmethod implementations */
+
+/* Create ORT session up front (READY->PAUSED), so the first buffer does not wait for it */
+static gboolean
+gst_ortobjectdetector_start (GstBaseTransform * base)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+
+  g_mutex_lock (&self->setup_lock);
+  self->started = TRUE;
+  g_mutex_unlock (&self->setup_lock);
+  self->stats->Reset();
+  self->last_stats_post = g_get_monotonic_time ();
+  if (!self->trace_writer) {
+    gst_ortobjectdetector_open_trace (self);
+  }
+  g_mutex_lock (&self->scheduler_lock);
+  if (self->use_scheduler && !self->scheduler_stream) {
+    InferenceScheduler& scheduler = InferenceScheduler::Get();
+    if (self->scheduler_slots > 0) {
+      scheduler.SetSlots(self->scheduler_slots);
+    }
+    if (self->scheduler_policy != GST_ORT_SCHEDULER_POLICY_DEFAULT) {
+      scheduler.SetPolicy(self->scheduler_policy == GST_ORT_SCHEDULER_POLICY_FAIR ? SchedulerPolicy::WEIGHTED_FAIR : SchedulerPolicy::EARLIEST_DEADLINE_FIRST);
+    }
+    self->scheduler_stream = scheduler.Register(self->priority);
+  }
+  g_mutex_unlock (&self->scheduler_lock);
+  if (self->num_sessions > 1 && !self->frame_pool) {
+    self->frame_pool = g_thread_pool_new (gst_ortobjectdetector_frame_worker, self, self->num_sessions, FALSE, NULL);
+  }
+  g_atomic_int_set (&self->init_failed, FALSE);
+  if (self->async_init) {
+    self->init_thread = g_thread_new ("ortobjectdetector-init", gst_ortobjectdetector_init_thread, self);
+    return TRUE;
+  }
+  if (!gst_ortobjectdetector_ort_setup (base)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, FAILED, ("Unable to initialize ORT client"), (NULL));
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_ortobjectdetector_stop (GstBaseTransform * base)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+
+  if (self->frame_pool) {
+    gst_ortobjectdetector_drain (self, TRUE);
+    g_thread_pool_free (self->frame_pool, FALSE, TRUE);
+    self->frame_pool = NULL;
+  }
+  g_mutex_lock (&self->scheduler_lock);
+  if (self->scheduler_stream) {
+    InferenceScheduler::Get().Unregister(self->scheduler_stream);
+    self->scheduler_stream = NULL;
+  }
+  g_mutex_unlock (&self->scheduler_lock);
+  // No hot-swap is started once stopped
+  g_mutex_lock (&self->setup_lock);
+  self->started = FALSE;
+  g_mutex_unlock (&self->setup_lock);
+  if (self->init_thread) {
+    g_thread_join (self->init_thread);
+    self->init_thread = NULL;
+  }
+  if (self->swap_thread) {
+    g_thread_join (self->swap_thread);
+    self->swap_thread = NULL;
+  }
+  gst_ortobjectdetector_finish_profiling (self);
+  gst_ortobjectdetector_close_trace (self);
+  // Release clients, so that the next start rebuilds them from current properties
+  std::shared_ptr<OrtClient> ort_client;
+  g_mutex_lock (&self->setup_lock);
+  g_atomic_int_set (&self->ready, FALSE);
+  g_atomic_int_set (&self->client_swapped, FALSE);
+  g_mutex_lock (&self->client_lock);
+  ort_client.swap (self->ort_client);
+  g_mutex_unlock (&self->client_lock);
+  self->daemon_client.reset ();
+  g_mutex_unlock (&self->setup_lock);
+  return TRUE;
+}
+
+/* this function does the actual processing (IP = in place)
+ */
+static GstFlowReturn
+gst_ortobjectdetector_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+  gboolean infer;
+  gfloat score_threshold;
+  gint64 deadline;
+
+  GstFlowReturn ret = gst_ortobjectdetector_prepare_frame (self, outbuf, &infer, &score_threshold, &deadline);
+  if (ret != GST_FLOW_OK) {
+    return ret;
+  }
+  if (!infer) {
+    self->stats->AddSkipped();
+    gst_ortobjectdetector_post_stats (self);
+    return GST_FLOW_OK;
   }
+  return gst_ortobjectdetector_infer_frame (self, outbuf, score_threshold, deadline);
+}
 
+/* With a frame pool, queue frames for concurrent inference instead of
+ * transforming them one at a time.
+ */
+static GstFlowReturn
+gst_ortobjectdetector_submit_input_buffer (GstBaseTransform * base, gboolean is_discont, GstBuffer * input)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+
+  if (!self->frame_pool) {
+    return GST_BASE_TRANSFORM_CLASS (parent_class)->submit_input_buffer (base, is_discont, input);
+  }
+
+  GstOrtFrameJob *job = g_new0 (GstOrtFrameJob, 1);
+  GstFlowReturn ret = gst_ortobjectdetector_prepare_frame (self, input, &job->infer, &job->score_threshold, &job->deadline);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (input);
+    g_free (job);
+    return ret;
+  }
+  if (!job->infer) {
+    self->stats->AddSkipped();
+    gst_ortobjectdetector_post_stats (self);
+  }
+  job->buffer = job->infer ? gst_buffer_make_writable (input) : input;
+  job->done = !job->infer;
+  job->ret = GST_FLOW_OK;
+
+  g_mutex_lock (&self->frame_lock);
+  g_queue_push_tail (&self->frame_queue, job);
+  g_mutex_unlock (&self->frame_lock);
+  if (job->infer) {
+    g_thread_pool_push (self->frame_pool, job, NULL);
+  }
   return GST_FLOW_OK;
 }
 
+/* With a frame pool, output the oldest queued frame once it is done, preserving
+ * stream order. Blocks while num-sessions frames are in flight.
+ */
+static GstFlowReturn
+gst_ortobjectdetector_generate_output (GstBaseTransform * base, GstBuffer ** outbuf)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (!self->frame_pool) {
+    return GST_BASE_TRANSFORM_CLASS (parent_class)->generate_output (base, outbuf);
+  }
+
+  *outbuf = NULL;
+  g_mutex_lock (&self->frame_lock);
+  GstOrtFrameJob *job = (GstOrtFrameJob *) g_queue_peek_head (&self->frame_queue);
+  while (job && !job->done && g_queue_get_length (&self->frame_queue) > (guint) self->num_sessions) {
+    g_cond_wait (&self->frame_cond, &self->frame_lock);
+  }
+  if (job && job->done) {
+    g_queue_pop_head (&self->frame_queue);
+    ret = job->ret;
+    if (ret == GST_FLOW_OK) {
+      *outbuf = job->buffer;
+    } else {
+      gst_buffer_unref (job->buffer);
+    }
+    g_free (job);
+  }
+  g_mutex_unlock (&self->frame_lock);
+  return ret;
+}
+
+/* Keep serialized events behind the frames queued before them */
+static gboolean
+gst_ortobjectdetector_sink_event (GstBaseTransform * base, GstEvent * event)
+{
+  Gstortobjectdetector *self = GST_ORTOBJECTDETECTOR (base);
+
+  if (self->frame_pool) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      gst_ortobjectdetector_drain (self, TRUE);
+    } else if (GST_EVENT_IS_SERIALIZED (event)) {
+      gst_ortobjectdetector_drain (self, FALSE);
+    }
+  }
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (base, event);
+}
+
 /* entry point to initialize the plug-in
  * initialize the plug-in itself
  * register the element factories and other features
@@ -389,7 +1779,11 @@ gst_ortobjectdetector_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
 static gboolean
 ortobjectdetector_init (GstPlugin * ortobjectdetector)
 {
-  return GST_ELEMENT_REGISTER (ortobjectdetector, ortobjectdetector);
+  gboolean res = GST_ELEMENT_REGISTER (ortobjectdetector, ortobjectdetector);
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+  res &= gst_tracer_register (ortobjectdetector, "ortstats", GST_TYPE_ORT_STATS_TRACER);
+#endif
+  return res;
 }
 
 // Needed for C++ template rather than C 
@@ -48,6 +48,11 @@
 #include <gst/base/gstbasetransform.h>
 
 #include "ortclient.h"
+#include "ortdaemonclient.h"
+#include "qualitygovernor.h"
+#include "inferencescheduler.h"
+#include "stagestats.h"
+#include "tracewriter.h"
 #include "gstortelement.h"
 
 G_BEGIN_DECLS
@@ -61,14 +66,94 @@ struct _Gstortobjectdetector {
 
   gchar *model_file;
   gchar *label_file;
-  std::unique_ptr<OrtClient> ort_client;
+  gchar *cache_dir;
+  // Current client, replaced on model hot-swap (protected by client_lock).
+  // client_cond is signalled when a user of a client releases it.
+  std::shared_ptr<OrtClient> ort_client;
+  GMutex client_lock;
+  GCond client_cond;
+  // Thin client of ort-daemon, used instead of ort_client when daemon_socket is set
+  gchar *daemon_socket;
+  std::shared_ptr<OrtDaemonClient> daemon_client;
+
+  // Session setup (serialized by setup_lock, optionally on init_thread)
+  GMutex setup_lock;
+  // Between start and stop (protected by setup_lock); hot-swaps only run while started
+  gboolean started;
+  GThread *init_thread;
+  GThread *swap_thread;
+  gboolean swap_running;
+  gboolean swap_pending;
+  gint client_swapped;
+  gboolean async_init;
+  gint warmup_iterations;
+  gboolean mmap_model;
+  gint ready;
+  gint init_failed;
 
   gfloat score_threshold;
   gfloat nms_threshold;
 
   gint device_id;
+  gint tile_rows;
+  gint tile_columns;
+  gfloat tile_overlap;
+  gint input_size;
+  gint inference_interval;
+
+  gboolean adaptive_quality;
+  gfloat target_latency;
+  gfloat target_fps;
+  std::unique_ptr<QualityGovernor> governor;
+  GMutex quality_lock;
+  // Orders input size changes, which are applied outside quality_lock
+  GMutex resize_lock;
+  guint64 frame_count;
+
+  // Session pool; frames are inferenced concurrently on frame_pool when num_sessions > 1
+  gint num_sessions;
+  gint session_threads;
+  gboolean pin_session_threads;
+  GThreadPool *frame_pool;
+  GQueue frame_queue;
+  GMutex frame_lock;
+  GCond frame_cond;
+
+  // Process-wide scheduling (see InferenceScheduler)
+  gboolean use_scheduler;
+  gint priority;
+  gfloat deadline;
+  // Process-wide scheduler configuration applied on start (0 / default = keep)
+  gint scheduler_slots;
+  GstOrtSchedulerPolicy scheduler_policy;
+  // Registered between start and stop (protected by scheduler_lock)
+  SchedulerStream *scheduler_stream;
+  GMutex scheduler_lock;
+  std::atomic<guint64> frames_served;
+  std::atomic<guint64> frames_dropped;
+
+  // Per-stage timings and counters, posted every stats_interval milliseconds
+  std::unique_ptr<StageStats> stats;
+  gfloat stats_interval;
+  std::atomic<gint64> last_stats_post;
+  // Per-frame spans written to trace_file (Chrome trace JSON) while running
+  gchar *trace_file;
+  std::unique_ptr<TraceWriter> trace_writer;
+  // ORT session profiling of the first profile_frames frames; profiles are
+  // collected in profiles (protected by profile_lock) and summarized on stop
+  gboolean enable_profiling;
+  gchar *profile_prefix;
+  guint profile_frames;
+  gint profiling;
+  std::atomic<guint64> profiled_frames;
+  std::vector<SessionProfile> profiles;
+  GMutex profile_lock;
+
   GstOrtOptimizationLevel optimization_level;
   GstOrtExecutionProvider execution_provider;
+  gboolean dnnl_use_arena;
+  gint xnnpack_threads;
+  gchar *openvino_device_type;
   GstOrtDetectionModel detection_model;
 };
 
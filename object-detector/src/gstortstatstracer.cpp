@@ -0,0 +1,318 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:tracer-ortstats
+ * @short_description: Latency histograms of ortobjectdetector elements.
+ *
+ * The ortstats tracer builds HDR-style latency histograms (log-linear buckets,
+ * within about 6% of the true value) of each stage of inference (preprocess, run,
+ * postprocess, draw, total) of every ortobjectdetector element, and of each
+ * frame's end-to-end latency across the element, from arriving at its sink pad to
+ * being pushed from its src pad (matched by PTS).
+ *
+ * An element's histograms are dumped when it pushes EOS, and those of all
+ * elements when the process receives SIGUSR1 (dispatched by the default GLib main
+ * context). Output goes to stderr, or is appended to the file given as a
+ * parameter:
+ *
+ * ```
+ * GST_TRACERS="ortstats(file=/tmp/ortstats.txt)" gst-launch-1.0 ...
+ * ```
+ *
+ * When the tracer is not enabled, elements only test a global pointer per frame.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <csignal>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <glib-unix.h>
+
+#include "gstortstatstracer.h"
+#include "gstortobjectdetector.h"
+#include "latencyhistogram.h"
+#include "stagestats.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_ort_stats_tracer_debug);
+#define GST_CAT_DEFAULT gst_ort_stats_tracer_debug
+
+std::atomic<GstOrtStatsTracer *> gst_ort_stats_tracer_active (NULL);
+
+// Histograms of one ortobjectdetector element, in microseconds
+struct OrtElementStats {
+  std::string name;
+  LatencyHistogram stages[INFERENCE_STAGE_COUNT];
+  LatencyHistogram end_to_end;
+  // Arrival time of frames in flight through the element, by PTS (protected by tracer lock)
+  std::unordered_map<GstClockTime, GstClockTime> arrivals;
+};
+
+// Upper bound on frames tracked in flight, in case some never leave the element
+#define MAX_ARRIVALS 4096
+
+struct _GstOrtStatsTracer {
+  GstTracer parent;
+
+  GMutex lock;
+  // Element stats, never removed while the tracer runs (protected by lock)
+  std::map<GstElement *, std::unique_ptr<OrtElementStats>> *elements;
+  gchar *file;
+  guint signal_source;
+};
+
+#define gst_ort_stats_tracer_parent_class parent_class
+G_DEFINE_TYPE (GstOrtStatsTracer, gst_ort_stats_tracer, GST_TYPE_TRACER);
+
+/* Stats of an element, created on first use */
+static OrtElementStats *
+gst_ort_stats_tracer_get_element (GstOrtStatsTracer *self, GstElement *element)
+{
+  g_mutex_lock (&self->lock);
+  std::unique_ptr<OrtElementStats>& stats = (*self->elements)[element];
+  if (!stats) {
+    stats.reset (new OrtElementStats ());
+    gchar *name = gst_element_get_name (element);
+    stats->name = name;
+    g_free (name);
+  }
+  OrtElementStats *res = stats.get ();
+  g_mutex_unlock (&self->lock);
+  return res;
+}
+
+static void
+gst_ort_stats_tracer_append_histogram (GString *out, const gchar *element, const gchar *stage, LatencyHistogram const& histogram)
+{
+  g_string_append_printf (out, "ortstats: %s %s: count=%" G_GUINT64_FORMAT
+      " min=%.3f mean=%.3f p50=%.3f p90=%.3f p99=%.3f p99.9=%.3f max=%.3f (ms)\n",
+      element, stage, histogram.GetCount (), histogram.GetMin () / 1000.0, histogram.GetMean () / 1000.0,
+      histogram.GetPercentile (0.5) / 1000.0, histogram.GetPercentile (0.9) / 1000.0,
+      histogram.GetPercentile (0.99) / 1000.0, histogram.GetPercentile (0.999) / 1000.0,
+      histogram.GetMax () / 1000.0);
+}
+
+/* Write histograms of one element (or of all, if element is NULL) */
+static void
+gst_ort_stats_tracer_dump (GstOrtStatsTracer *self, GstElement *element)
+{
+  GString *out = g_string_new (NULL);
+  g_mutex_lock (&self->lock);
+  for (auto const& entry : *self->elements) {
+    if (element && entry.first != element) {
+      continue;
+    }
+    OrtElementStats const& stats = *entry.second;
+    for (int i = 0; i < INFERENCE_STAGE_COUNT; i++) {
+      InferenceStage stage = (InferenceStage) i;
+      gst_ort_stats_tracer_append_histogram (out, stats.name.c_str (), StageStats::GetStageName (stage), stats.stages[i]);
+    }
+    gst_ort_stats_tracer_append_histogram (out, stats.name.c_str (), "end-to-end", stats.end_to_end);
+  }
+  g_mutex_unlock (&self->lock);
+
+  if (self->file) {
+    FILE *f = fopen (self->file, "a");
+    if (f) {
+      fputs (out->str, f);
+      fclose (f);
+    } else {
+      GST_WARNING_OBJECT (self, "Unable to open '%s' for writing", self->file);
+    }
+  } else {
+    g_printerr ("%s", out->str);
+  }
+  g_string_free (out, TRUE);
+}
+
+static gboolean
+gst_ort_stats_tracer_on_signal (gpointer data)
+{
+  gst_ort_stats_tracer_dump (GST_ORT_STATS_TRACER (data), NULL);
+  return G_SOURCE_CONTINUE;
+}
+
+/* Detector element a pad belongs to, if any */
+static GstElement *
+gst_ort_stats_tracer_get_detector (GstPad *pad)
+{
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+  return parent && GST_IS_ORTOBJECTDETECTOR (parent) ? GST_ELEMENT (parent) : NULL;
+}
+
+/* Track a buffer entering or leaving a detector */
+static void
+gst_ort_stats_tracer_on_buffer (GstOrtStatsTracer *self, GstClockTime ts, GstPad *pad, GstBuffer *buffer)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (pts)) {
+    return;
+  }
+
+  GstElement *detector = gst_ort_stats_tracer_get_detector (pad);
+  if (detector) {
+    OrtElementStats *stats = gst_ort_stats_tracer_get_element (self, detector);
+    g_mutex_lock (&self->lock);
+    auto it = stats->arrivals.find (pts);
+    if (it != stats->arrivals.end ()) {
+      GstClockTime arrival = it->second;
+      stats->arrivals.erase (it);
+      g_mutex_unlock (&self->lock);
+      stats->end_to_end.Record ((ts - arrival) / GST_USECOND);
+    } else {
+      g_mutex_unlock (&self->lock);
+    }
+  }
+
+  GstPad *peer = gst_pad_get_peer (pad);
+  if (!peer) {
+    return;
+  }
+  detector = gst_ort_stats_tracer_get_detector (peer);
+  if (detector) {
+    OrtElementStats *stats = gst_ort_stats_tracer_get_element (self, detector);
+    g_mutex_lock (&self->lock);
+    if (stats->arrivals.size () >= MAX_ARRIVALS) {
+      stats->arrivals.clear ();
+    }
+    stats->arrivals[pts] = ts;
+    g_mutex_unlock (&self->lock);
+  }
+  gst_object_unref (peer);
+}
+
+static void
+gst_ort_stats_tracer_do_push_buffer_pre (GstTracer *tracer, GstClockTime ts, GstPad *pad, GstBuffer *buffer)
+{
+  gst_ort_stats_tracer_on_buffer (GST_ORT_STATS_TRACER (tracer), ts, pad, buffer);
+}
+
+static void
+gst_ort_stats_tracer_do_push_buffer_list_pre (GstTracer *tracer, GstClockTime ts, GstPad *pad, GstBufferList *list)
+{
+  guint length = gst_buffer_list_length (list);
+  for (guint i = 0; i < length; i++) {
+    gst_ort_stats_tracer_on_buffer (GST_ORT_STATS_TRACER (tracer), ts, pad, gst_buffer_list_get (list, i));
+  }
+}
+
+static void
+gst_ort_stats_tracer_do_push_event_pre (GstTracer *tracer, GstClockTime ts, GstPad *pad, GstEvent *event)
+{
+  if (GST_EVENT_TYPE (event) != GST_EVENT_EOS) {
+    return;
+  }
+  GstElement *detector = gst_ort_stats_tracer_get_detector (pad);
+  if (detector) {
+    gst_ort_stats_tracer_dump (GST_ORT_STATS_TRACER (tracer), detector);
+  }
+}
+
+/**
+ * Record an inferenced frame's stage timings. Called through
+ * gst_ort_stats_trace_frame by elements, from any streaming thread.
+ */
+void
+gst_ort_stats_tracer_record_frame (GstOrtStatsTracer *tracer, GstElement *element, DetectionTimings const& timings, gint64 total_us)
+{
+  OrtElementStats *stats = gst_ort_stats_tracer_get_element (tracer, element);
+  stats->stages[INFERENCE_STAGE_PREPROCESS].Record (timings.preprocess_us);
+  stats->stages[INFERENCE_STAGE_RUN].Record (timings.run_us);
+  stats->stages[INFERENCE_STAGE_POSTPROCESS].Record (timings.postprocess_us);
+  stats->stages[INFERENCE_STAGE_DRAW].Record (timings.draw_us);
+  stats->stages[INFERENCE_STAGE_TOTAL].Record (total_us);
+}
+
+static void
+gst_ort_stats_tracer_constructed (GObject *object)
+{
+  GstOrtStatsTracer *self = GST_ORT_STATS_TRACER (object);
+  gchar *params = NULL;
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  g_object_get (self, "params", &params, NULL);
+  if (params) {
+    gchar *description = g_strdup_printf ("ortstats,%s", params);
+    GstStructure *structure = gst_structure_from_string (description, NULL);
+    if (structure) {
+      self->file = g_strdup (gst_structure_get_string (structure, "file"));
+      gst_structure_free (structure);
+    } else {
+      GST_WARNING_OBJECT (self, "Unable to parse parameters '%s'", params);
+    }
+    g_free (description);
+    g_free (params);
+  }
+}
+
+static void
+gst_ort_stats_tracer_finalize (GObject *object)
+{
+  GstOrtStatsTracer *self = GST_ORT_STATS_TRACER (object);
+  GstOrtStatsTracer *active = self;
+
+  gst_ort_stats_tracer_active.compare_exchange_strong (active, NULL);
+  if (self->signal_source) {
+    g_source_remove (self->signal_source);
+  }
+  delete self->elements;
+  g_free (self->file);
+  g_mutex_clear (&self->lock);
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_ort_stats_tracer_class_init (GstOrtStatsTracerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->constructed = gst_ort_stats_tracer_constructed;
+  gobject_class->finalize = gst_ort_stats_tracer_finalize;
+
+  GST_DEBUG_CATEGORY_INIT (gst_ort_stats_tracer_debug, "ortstats", 0,
+      "ortobjectdetector latency histograms tracer");
+}
+
+static void
+gst_ort_stats_tracer_init (GstOrtStatsTracer *self)
+{
+  GstTracer *tracer = GST_TRACER (self);
+
+  g_mutex_init (&self->lock);
+  self->elements = new std::map<GstElement *, std::unique_ptr<OrtElementStats>> ();
+  self->file = NULL;
+  self->signal_source = g_unix_signal_add (SIGUSR1, gst_ort_stats_tracer_on_signal, self);
+
+  gst_tracing_register_hook (tracer, "pad-push-pre",
+      G_CALLBACK (gst_ort_stats_tracer_do_push_buffer_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre",
+      G_CALLBACK (gst_ort_stats_tracer_do_push_buffer_list_pre));
+  gst_tracing_register_hook (tracer, "pad-push-event-pre",
+      G_CALLBACK (gst_ort_stats_tracer_do_push_event_pre));
+
+  gst_ort_stats_tracer_active.store (self);
+}
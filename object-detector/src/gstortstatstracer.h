@@ -0,0 +1,66 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_ORT_STATS_TRACER_H__
+#define __GST_ORT_STATS_TRACER_H__
+
+#include <atomic>
+#include <gst/gst.h>
+#include <gst/gsttracer.h>
+
+#include "detection.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_ORT_STATS_TRACER (gst_ort_stats_tracer_get_type())
+#define GST_ORT_STATS_TRACER(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_ORT_STATS_TRACER,GstOrtStatsTracer))
+#define GST_IS_ORT_STATS_TRACER(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_ORT_STATS_TRACER))
+
+typedef struct _GstOrtStatsTracer GstOrtStatsTracer;
+typedef struct _GstOrtStatsTracerClass GstOrtStatsTracerClass;
+
+struct _GstOrtStatsTracerClass {
+  GstTracerClass parent_class;
+};
+
+GType gst_ort_stats_tracer_get_type (void);
+
+G_END_DECLS
+
+// Running ortstats tracer, or NULL when GST_TRACERS does not include it
+extern std::atomic<GstOrtStatsTracer *> gst_ort_stats_tracer_active;
+
+void gst_ort_stats_tracer_record_frame (GstOrtStatsTracer *tracer, GstElement *element, DetectionTimings const& timings, gint64 total_us);
+
+/* Record an inferenced frame's stage timings with the ortstats tracer. Costs a
+ * single pointer test when the tracer is not enabled.
+ */
+static inline void
+gst_ort_stats_trace_frame (GstElement *element, DetectionTimings const& timings, gint64 total_us)
+{
+  GstOrtStatsTracer *tracer = gst_ort_stats_tracer_active.load (std::memory_order_relaxed);
+  if (G_LIKELY (tracer == NULL)) {
+    return;
+  }
+  gst_ort_stats_tracer_record_frame (tracer, element, timings, total_us);
+}
+
+#endif /* __GST_ORT_STATS_TRACER_H__ */
@@ -0,0 +1,209 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "inferencescheduler.h"
+
+/**
+ * @brief Construct the InferenceScheduler, reading its configuration from the environment.
+ */
+InferenceScheduler::InferenceScheduler() : policy(SchedulerPolicy::EARLIEST_DEADLINE_FIRST), slots(std::max<int>(std::thread::hardware_concurrency(), 1)), running(0), virtual_time(0.0), next_sequence(0) {
+  const char *env_slots = std::getenv("GST_ORT_SCHEDULER_SLOTS");
+  if (env_slots && std::atoi(env_slots) > 0) {
+    slots = std::atoi(env_slots);
+  }
+  const char *env_policy = std::getenv("GST_ORT_SCHEDULER_POLICY");
+  if (env_policy && std::strcmp(env_policy, "fair") == 0) {
+    policy = SchedulerPolicy::WEIGHTED_FAIR;
+  }
+}
+
+/**
+ * @return InferenceScheduler& the process-wide scheduler.
+ */
+InferenceScheduler& InferenceScheduler::Get() {
+  static InferenceScheduler scheduler;
+  return scheduler;
+}
+
+/**
+ * @return int64_t current time of the steady clock deadlines are expressed in, in microseconds.
+ */
+int64_t InferenceScheduler::Now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Sets the number of inferences run at a time. Takes effect for
+ * requests waiting at the time of the call.
+ * 
+ * @param slots number of inference slots (>= 1).
+ */
+void InferenceScheduler::SetSlots(int slots) {
+  std::lock_guard<std::mutex> guard(lock);
+  this->slots = std::max(slots, 1);
+  cond.notify_all();
+}
+
+int InferenceScheduler::GetSlots() {
+  std::lock_guard<std::mutex> guard(lock);
+  return slots;
+}
+
+/**
+ * @brief Sets the order in which waiting requests are served.
+ * 
+ * @param policy scheduling policy.
+ */
+void InferenceScheduler::SetPolicy(SchedulerPolicy policy) {
+  std::lock_guard<std::mutex> guard(lock);
+  this->policy = policy;
+  cond.notify_all();
+}
+
+SchedulerPolicy InferenceScheduler::GetPolicy() {
+  std::lock_guard<std::mutex> guard(lock);
+  return policy;
+}
+
+/**
+ * @brief Registers a new stream of inference requests.
+ * 
+ * @param priority stream priority (>= 1), i.e. its weight under fair queueing.
+ * @return SchedulerStream* stream handle, to be released with Unregister.
+ */
+SchedulerStream* InferenceScheduler::Register(int priority) {
+  std::lock_guard<std::mutex> guard(lock);
+  SchedulerStream *stream = new SchedulerStream();
+  stream->priority = std::max(priority, 1);
+  stream->avg_cost_us = 0.0;
+  // New streams start at the current virtual time, rather than claiming service they missed
+  stream->finish_tag = virtual_time;
+  return stream;
+}
+
+/**
+ * @brief Removes stream from scheduler. Stream must not have requests in progress.
+ * 
+ * @param stream stream to remove.
+ */
+void InferenceScheduler::Unregister(SchedulerStream *stream) {
+  std::lock_guard<std::mutex> guard(lock);
+  delete stream;
+}
+
+void InferenceScheduler::SetPriority(SchedulerStream *stream, int priority) {
+  std::lock_guard<std::mutex> guard(lock);
+  stream->priority = std::max(priority, 1);
+}
+
+/**
+ * @return true if request a is to be served before request b.
+ */
+bool InferenceScheduler::Precedes(Request const* a, Request const* b) {
+  if (policy == SchedulerPolicy::EARLIEST_DEADLINE_FIRST) {
+    int64_t deadline_a = a->deadline_us > 0 ? a->deadline_us : INT64_MAX;
+    int64_t deadline_b = b->deadline_us > 0 ? b->deadline_us : INT64_MAX;
+    if (deadline_a != deadline_b) {
+      return deadline_a < deadline_b;
+    }
+    if (a->stream->priority != b->stream->priority) {
+      return a->stream->priority > b->stream->priority;
+    }
+  } else if (a->start_tag != b->start_tag) {
+    return a->start_tag < b->start_tag;
+  }
+  return a->sequence < b->sequence;
+}
+
+// Waiting request to serve next, or NULL if none are waiting
+InferenceScheduler::Request* InferenceScheduler::Pick() {
+  Request *best = NULL;
+  for (Request *request : waiting) {
+    if (!best || Precedes(request, best)) {
+      best = request;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Waits for an inference slot. A request is shed (without waiting any
+ * longer) once the stream's average inference time no longer fits before its
+ * deadline.
+ * 
+ * @param stream stream making the request.
+ * @param deadline_us time (see Now) by which inference must complete, or 0 for no deadline.
+ * @return true if a slot was acquired; caller must call Release after inferencing.
+ * @return false if the request was shed.
+ */
+bool InferenceScheduler::Acquire(SchedulerStream *stream, int64_t deadline_us) {
+  std::unique_lock<std::mutex> guard(lock);
+  Request request;
+  request.stream = stream;
+  request.deadline_us = deadline_us;
+  request.start_tag = std::max(virtual_time, stream->finish_tag);
+  request.sequence = next_sequence++;
+  waiting.push_back(&request);
+  while (true) {
+    int64_t latest_start = deadline_us - (int64_t) stream->avg_cost_us;
+    if (deadline_us > 0 && Now() > latest_start) {
+      waiting.remove(&request);
+      cond.notify_all();
+      return false;
+    }
+    if (running < slots && Pick() == &request) {
+      waiting.remove(&request);
+      running++;
+      virtual_time = std::max(virtual_time, request.start_tag);
+      stream->finish_tag = request.start_tag + stream->avg_cost_us / stream->priority;
+      // Further slots may be free for other waiting requests
+      cond.notify_all();
+      return true;
+    }
+    if (deadline_us > 0) {
+      cond.wait_until(guard, std::chrono::steady_clock::time_point(std::chrono::microseconds(latest_start)));
+    } else {
+      cond.wait(guard);
+    }
+  }
+}
+
+/**
+ * @brief Returns inference slot acquired with Acquire.
+ * 
+ * @param stream stream that acquired the slot.
+ * @param cost_us time spent inferencing, in microseconds.
+ */
+void InferenceScheduler::Release(SchedulerStream *stream, int64_t cost_us) {
+  std::lock_guard<std::mutex> guard(lock);
+  running--;
+  if (stream->avg_cost_us == 0.0) {
+    stream->avg_cost_us = cost_us;
+  } else {
+    stream->avg_cost_us = COST_SMOOTHING * cost_us + (1.0 - COST_SMOOTHING) * stream->avg_cost_us;
+  }
+  cond.notify_all();
+}
@@ -0,0 +1,98 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __INFERENCE_SCHEDULER_H__
+#define __INFERENCE_SCHEDULER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+// Order in which waiting inference requests are served
+enum class SchedulerPolicy {
+  // Earliest deadline first; priority breaks ties, requests without deadline go last
+  EARLIEST_DEADLINE_FIRST,
+  // Start-time fair queueing, sharing inference time in proportion to priority
+  WEIGHTED_FAIR
+};
+
+// Stream of inference requests (e.g. one element) registered with the scheduler
+struct SchedulerStream {
+  int priority;
+  // Moving average of inference time, used to shed requests that cannot meet their deadline
+  double avg_cost_us;
+  // Fair queueing finish tag of the stream's latest request
+  double finish_tag;
+};
+
+/**
+ * @brief Process-wide inference scheduler. Limits the number of concurrent
+ * inferences across all streams in the process, handing out inference slots
+ * by policy. Requests that can no longer meet their deadline are shed.
+ * 
+ * Callers bracket each inference with Acquire and Release on their own thread.
+ * The number of slots and policy are set with SetSlots and SetPolicy. Their
+ * defaults are read from the GST_ORT_SCHEDULER_SLOTS (default: number of
+ * processors) and GST_ORT_SCHEDULER_POLICY ("edf" or "fair", default "edf")
+ * environment variables on first use.
+ */
+class InferenceScheduler {
+  private:
+    // Smoothing factor for inference time moving average
+    const double COST_SMOOTHING = 0.1;
+
+    struct Request {
+      SchedulerStream *stream;
+      int64_t deadline_us;
+      double start_tag;
+      uint64_t sequence;
+    };
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::list<Request*> waiting;
+    SchedulerPolicy policy;
+    int slots;
+    int running;
+    // Fair queueing virtual time: start tag of the latest request granted
+    double virtual_time;
+    uint64_t next_sequence;
+
+    InferenceScheduler();
+    Request* Pick();
+    bool Precedes(Request const* a, Request const* b);
+
+  public:
+    static InferenceScheduler& Get();
+    static int64_t Now();
+    SchedulerStream* Register(int priority);
+    void Unregister(SchedulerStream *stream);
+    void SetPriority(SchedulerStream *stream, int priority);
+    bool Acquire(SchedulerStream *stream, int64_t deadline_us);
+    void Release(SchedulerStream *stream, int64_t cost_us);
+    void SetSlots(int slots);
+    int GetSlots();
+    void SetPolicy(SchedulerPolicy policy);
+    SchedulerPolicy GetPolicy();
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "latencyhistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+// Clears all recorded values. Not atomic with respect to concurrent Record calls.
+void LatencyHistogram::Reset() {
+  for (auto& count : counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  total_count.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  min.store(UINT64_MAX, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Index of the bucket holding a value. Values below SUB_BUCKETS have a
+ * bucket each; above, the magnitude picks a group of SUB_BUCKETS buckets and the
+ * next SUB_BUCKET_BITS bits below the most significant bit pick the bucket.
+ */
+int LatencyHistogram::GetBucket(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return (int) value;
+  }
+  int msb = 63 - __builtin_clzll(value);
+  if (msb >= MAX_BITS) {
+    return NUM_BUCKETS - 1;
+  }
+  int shift = msb - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKETS + (int) ((value >> shift) - SUB_BUCKETS);
+}
+
+// Largest value held by a bucket
+uint64_t LatencyHistogram::GetBucketUpperBound(int bucket) {
+  if (bucket < (int) SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t sub_bucket = bucket % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  counts[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+  total_count.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(value, std::memory_order_relaxed);
+  uint64_t current = min.load(std::memory_order_relaxed);
+  while (value < current && !min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  current = max.load(std::memory_order_relaxed);
+  while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+  return total_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMin() const {
+  return GetCount() > 0 ? min.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+  return max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const {
+  uint64_t count = GetCount();
+  return count > 0 ? (double) sum.load(std::memory_order_relaxed) / count : 0;
+}
+
+/**
+ * @brief Value at or below which the given fraction of recorded values lie, to
+ * within the bucket resolution (reported as the bucket's upper bound, capped at
+ * the largest value recorded).
+ * 
+ * @param percentile fraction in [0, 1], e.g. 0.99.
+ * @return uint64_t percentile value, or 0 if no values were recorded.
+ */
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+  uint64_t count = GetCount();
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(percentile * count));
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+    seen += counts[bucket].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(GetBucketUpperBound(bucket), GetMax());
+    }
+  }
+  return GetMax();
+}
@@ -0,0 +1,63 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief HDR-style latency histogram with log-linear buckets: each power of two
+ * is split into SUB_BUCKETS linear buckets, giving a relative error of at most
+ * 1/SUB_BUCKETS over the whole range. Values are integers (e.g. microseconds).
+ * Recording is lock-free and may happen from any number of threads.
+ */
+class LatencyHistogram {
+  private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // Largest magnitude tracked (2^40 µs is about 12 days), larger values are clamped
+    static const int MAX_BITS = 40;
+    static const int NUM_BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::atomic<uint64_t> counts[NUM_BUCKETS];
+    std::atomic<uint64_t> total_count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+
+    static int GetBucket(uint64_t value);
+    static uint64_t GetBucketUpperBound(int bucket);
+
+  public:
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+    void Reset();
+    void Record(uint64_t value);
+    uint64_t GetCount() const;
+    uint64_t GetMin() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    uint64_t GetPercentile(double percentile) const;
+};
+
+#endif
@@ -23,20 +23,45 @@
 #define __OBJECT_DETECTION_MODEL_H__
 
 #include <cstdint>
+#include <memory>
 #include <onnxruntime_cxx_api.h>
 #include <gst/video/video.h>
+#include "detection.h"
+
+/**
+ * @brief Per-call scratch state of an object detection model (e.g. the
+ * original image and candidate boxes). A model instance holds only its
+ * configuration, so concurrent calls each use their own context.
+ */
+class ModelContext {
+  public:
+    virtual ~ModelContext() = default;
+};
 
 /**
  * @brief Interface for an ML object detection model.
  * Includes pre/post-processing steps and model information.
+ * Preprocess and Postprocess of a frame must be passed the same context.
+ * A frame occupies GetBatchSize() consecutive entries of the input/output batch;
+ * several frames may be batched together.
  */
 class ObjectDetectionModel {
   public:
     virtual ~ObjectDetectionModel() = 0;
     virtual size_t GetNumClasses() = 0;
     virtual size_t GetInputTensorSize() = 0;
-    virtual void Preprocess(uint8_t* const data, std::vector<float>& input_tensor_values, int width, int height, bool is_rgb) = 0;
-    virtual void Postprocess(std::vector<Ort::Value> const& model_output, std::vector<std::string> const& class_labels, float score_threshold, float nms_threshold) = 0;
+    virtual size_t GetBatchSize() = 0;
+    virtual int GetInputWidth() = 0;
+    virtual int GetInputHeight() = 0;
+    virtual bool IsChannelsLast() = 0;
+    virtual bool SetInputSize(int width, int height) = 0;
+    virtual bool SetOutputShapes(std::vector<std::vector<int64_t>> const& output_dims) = 0;
+    virtual void SetTiling(int rows, int cols, float overlap) = 0;
+    virtual std::unique_ptr<ModelContext> CreateContext() = 0;
+    virtual void Preprocess(ModelContext& context, uint8_t* const data, float *input_tensor_values, int width, int height, bool is_rgb) = 0;
+    virtual void Preprocess(ModelContext& context, uint8_t* const data, uint8_t *input_tensor_values, int width, int height, bool is_rgb) = 0;
+    virtual void Preprocess(ModelContext& context, uint8_t* const data, Ort::Float16_t *input_tensor_values, int width, int height, bool is_rgb) = 0;
+    virtual void Postprocess(ModelContext& context, std::vector<Ort::Value> const& model_output, size_t batch_index, float score_threshold, float nms_threshold, std::vector<Detection>& detections) = 0;
 };
 
 #endif
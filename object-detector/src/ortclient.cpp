@@ -19,19 +19,28 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
+#include <unordered_map>
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include "ortclient.h"
 #include "yolov4.h"
+#include "yolov8.h"
 
 #include <providers/cpu/cpu_provider_factory.h>
 #ifdef GST_ML_ONNX_RUNTIME_HAVE_CUDA
 #include <providers/cuda/cuda_provider_factory.h>
 #endif
+#ifdef GST_ML_ONNX_RUNTIME_HAVE_DNNL
+#include <providers/dnnl/dnnl_provider_factory.h>
+#endif
 
 /**
  * @brief Construct a OrtClient object. Creates ORT environment.
  */
-OrtClient::OrtClient() {
+OrtClient::OrtClient() : is_init(false), tile_rows(1), tile_cols(1), tile_overlap(0.0f), mmap_model(false), execution_provider(GST_ORT_EXECUTION_PROVIDER_CPU), input_size(0), num_sessions(1), session_threads(0), pin_session_threads(false) {
   try {
     env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "test");
   } catch (Ort::Exception& e) {
@@ -39,6 +48,17 @@ OrtClient::OrtClient() {
   }
 }
 
+/**
+ * @brief Destroy the OrtClient object. Releases sessions before unmapping
+ * model bytes they may reference.
+ */
+OrtClient::~OrtClient() {
+  sessions.clear();
+  for (GMappedFile *mapped : mapped_models) {
+    g_mapped_file_unref(mapped);
+  }
+}
+
 /**
  * @return true if an ORT session has succesfully been created.
  * @return false otherwise.
@@ -47,6 +67,471 @@ bool OrtClient::IsInitialized() {
   return is_init;
 }
 
+/**
+ * @brief Configures tiled inference. Must be called before Init.
+ * Tiles of each frame are inferenced together as a single batch.
+ * 
+ * @param rows number of tile rows.
+ * @param cols number of tile columns.
+ * @param overlap fraction of a tile shared with its neighbours.
+ */
+void OrtClient::SetTiling(int rows, int cols, float overlap) {
+  tile_rows = rows;
+  tile_cols = cols;
+  tile_overlap = overlap;
+}
+
+/**
+ * @brief Selects the (square) model input size. May be called before Init, or
+ * afterwards to change the input size of an initialized client.
+ * Only models with dynamic input height/width accept sizes differing from
+ * their exported shape.
+ * 
+ * @param size input width and height, or 0 to use the model's own dimensions.
+ * @return true if size was applied (or will be applied on Init).
+ * @return false if an initialized client was unable to use the size.
+ */
+bool OrtClient::SetInputSize(int size) {
+  // Wait for calls in progress, which depend on the current size
+  std::unique_lock<std::shared_timed_mutex> config_guard(config_lock);
+  int prev_size = input_size;
+  input_size = size;
+  if (is_init && !ResolveInputSize()) {
+    input_size = prev_size;
+    ResolveInputSize();
+    return false;
+  }
+  return true;
+}
+
+// Current model input width (input is square when set through SetInputSize)
+int OrtClient::GetInputSize() {
+  return model ? model->GetInputWidth() : input_size;
+}
+
+/**
+ * @return true if model input height and width are dynamic axes.
+ * @return false otherwise, or if the client has not been initialized.
+ */
+bool OrtClient::HasDynamicInputSize() {
+  if (!is_init) {
+    return false;
+  }
+  size_t h_index = model->IsChannelsLast() ? 1 : 2;
+  size_t w_index = model->IsChannelsLast() ? 2 : 3;
+  return model_input_dims[h_index] == -1 && model_input_dims[w_index] == -1;
+}
+
+/**
+ * @brief Enables caching of optimized models. Must be called before Init.
+ * On first start, the optimized graph is saved in ORT format to the cache directory;
+ * later starts load it directly, skipping graph optimization.
+ * 
+ * @param dir cache directory, or empty string to disable caching.
+ */
+void OrtClient::SetCacheDir(std::string const& dir) {
+  cache_dir = dir;
+}
+
+/**
+ * @brief Enables memory-mapped model loading. Must be called before Init.
+ * The cached ORT format model (see SetCacheDir) is mapped read-only and the
+ * session uses the mapped bytes directly for initializers, so weights are
+ * shared between processes through the page cache. ONNX models are never
+ * mapped: ORT parses them into buffers of its own, so mapping saves nothing.
+ * 
+ * @param enable whether to memory-map the model.
+ */
+void OrtClient::SetMemoryMapModel(bool enable) {
+  mmap_model = enable;
+}
+
+/**
+ * @brief Configures a pool of sessions. Must be called before Init.
+ * Each session gets a small intra-op thread pool of its own, which scales
+ * better on many-core hosts than one session with a large thread pool.
+ * Sessions share prepacked weights (and, with memory mapping and an ORT
+ * format cached model, the initializers themselves).
+ * 
+ * @param count number of sessions.
+ * @param threads_per_session intra-op threads per session (0 = ORT default).
+ * @param pin_threads pin each session's threads to its own set of cores.
+ */
+void OrtClient::SetSessionPool(int count, int threads_per_session, bool pin_threads) {
+  num_sessions = std::max(count, 1);
+  session_threads = std::max(threads_per_session, 0);
+  pin_session_threads = pin_threads;
+}
+
+// Number of sessions that may run concurrently
+int OrtClient::GetNumSessions() {
+  return num_sessions;
+}
+
+// Execution provider the sessions use, which is CPU when the requested provider was unavailable
+GstOrtExecutionProvider OrtClient::GetExecutionProvider() {
+  return execution_provider;
+}
+
+/**
+ * @brief Enables ORT's session profiler. Must be called before Init. Each
+ * session of the pool writes its own profile, named after the prefix and the
+ * session's index, once EndProfiling is called (or the session is destroyed).
+ * 
+ * @param prefix profile file prefix, or empty string to disable profiling.
+ */
+void OrtClient::SetProfiling(std::string const& prefix) {
+  profile_prefix = prefix;
+}
+
+/**
+ * @brief Ends profiling of all sessions, writing their profiles. Sessions are
+ * no longer profiled afterwards.
+ * 
+ * @return std::vector<SessionProfile> profiles written, empty if profiling was not enabled.
+ */
+std::vector<SessionProfile> OrtClient::EndProfiling() {
+  std::vector<SessionProfile> profiles;
+  if (!is_init || profile_prefix.empty()) {
+    return profiles;
+  }
+  // Wait for calls in progress, which may still add events
+  std::unique_lock<std::shared_timed_mutex> config_guard(config_lock);
+  try {
+    for (auto& slot : sessions) {
+      uint64_t start_ns = slot->session.GetProfilingStartTimeNs();
+      Ort::AllocatedStringPtr path = slot->session.EndProfilingAllocated(allocator);
+      if (path && *path.get()) {
+        profiles.push_back(SessionProfile{path.get(), start_ns});
+      }
+    }
+  } catch (Ort::Exception& e) {
+    GST_ERROR ("%s\n", e.what());
+  }
+  profile_prefix.clear();
+  return profiles;
+}
+
+/**
+ * @brief Sets thread options of a pooled session. With pinning, session i
+ * uses cores [i * threads, (i + 1) * threads), wrapping around the number of
+ * processors. ORT pins the intra-op threads it creates, the calling thread
+ * being the session's remaining thread.
+ * 
+ * @param options session options to modify.
+ * @param index index of session in pool.
+ */
+void OrtClient::ConfigureSessionThreads(Ort::SessionOptions& options, size_t index) {
+  if (session_threads == 0) {
+    return;
+  }
+  options.SetIntraOpNumThreads(session_threads);
+  if (!pin_session_threads || session_threads < 2) {
+    return;
+  }
+  int num_processors = g_get_num_processors();
+  std::string affinities;
+  for (int i = 1; i < session_threads; i++) {
+    // Processor IDs are 1-based, and threads are separated by ';'
+    int processor = (int) ((index * session_threads + i) % num_processors) + 1;
+    affinities += (i > 1 ? ";" : "") + std::to_string(processor);
+  }
+  options.AddConfigEntry("session.intra_op_thread_affinities", affinities.c_str());
+}
+
+/**
+ * @brief Creates sessions [first, last) of the pool from model file,
+ * memory-mapping ORT format files if enabled. Falls back to regular loading
+ * if the file cannot be mapped. All sessions created from the same path share a
+ * single mapping.
+ * 
+ * @param path path to model file.
+ * @param options session options.
+ * @param ort_format whether model file is in ORT format.
+ * @param first index of first session to create.
+ * @param last index past last session to create.
+ */
+void OrtClient::LoadSessions(std::string const& path, Ort::SessionOptions const& options, bool ort_format, size_t first, size_t last) {
+  GMappedFile *mapped = NULL;
+  if (mmap_model && ort_format) {
+    GError *error = NULL;
+    mapped = g_mapped_file_new(path.c_str(), FALSE, &error);
+    if (!mapped) {
+      GST_WARNING ("Unable to memory-map model %s: %s", path.c_str(), error->message);
+      g_clear_error(&error);
+    }
+  }
+  try {
+    for (size_t i = first; i < last; i++) {
+      Ort::SessionOptions slot_options = options.Clone();
+      ConfigureSessionThreads(slot_options, i);
+      if (!profile_prefix.empty()) {
+        // ORT names profiles by prefix and time, so sessions created within the same second need prefixes of their own
+        slot_options.EnableProfiling((profile_prefix + "-" + std::to_string(i)).c_str());
+      }
+      if (mapped) {
+        // Reference mapped bytes (and initializers within them) instead of copying
+        slot_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+        slot_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+      }
+      if (mapped && prepacked_weights) {
+        sessions[i]->session = Ort::Session(env, g_mapped_file_get_contents(mapped), g_mapped_file_get_length(mapped), slot_options, prepacked_weights);
+      } else if (mapped) {
+        sessions[i]->session = Ort::Session(env, g_mapped_file_get_contents(mapped), g_mapped_file_get_length(mapped), slot_options);
+      } else if (prepacked_weights) {
+        sessions[i]->session = Ort::Session(env, path.c_str(), slot_options, prepacked_weights);
+      } else {
+        sessions[i]->session = Ort::Session(env, path.c_str(), slot_options);
+      }
+    }
+  } catch (Ort::Exception& e) {
+    // Sessions already created may reference the mapping
+    for (size_t i = first; i < last; i++) {
+      sessions[i]->session = Ort::Session{nullptr};
+    }
+    if (mapped) {
+      g_mapped_file_unref(mapped);
+    }
+    throw;
+  }
+  // Mapping must outlive the sessions
+  if (mapped) {
+    mapped_models.push_back(mapped);
+  }
+}
+
+// SHA-256 of the file's contents followed by suffix, or empty string if the file cannot be read
+static std::string HashModelFile(std::string const& path, std::string const& suffix) {
+  std::ifstream model_file(path, std::ios::binary);
+  if (!model_file.good()) {
+    return "";
+  }
+  GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+  std::vector<char> chunk(1 << 20);
+  while (model_file.read(chunk.data(), chunk.size()) || model_file.gcount() > 0) {
+    g_checksum_update(checksum, (const guchar*) chunk.data(), model_file.gcount());
+  }
+  g_checksum_update(checksum, (const guchar*) suffix.c_str(), suffix.size());
+  std::string key = g_checksum_get_string(checksum);
+  g_checksum_free(checksum);
+  return key;
+}
+
+/**
+ * @brief Computes cache location for optimized model. The file name is keyed on
+ * a hash of the model file contents, ORT version, session options and provider
+ * options, so that a change to any of these invalidates the cached model.
+ * To avoid hashing large models on every start, a small index entry records the
+ * key along with the model path, size and modification time; the model is only
+ * hashed again when these change. The entry cached for the model's previous
+ * contents is then removed.
+ * 
+ * @param opti_level ORT optimization level.
+ * @param provider ORT execution provider.
+ * @param device_id hardware acceleration device ID.
+ * @return std::string path to cached model, or empty string if model could not be hashed.
+ */
+std::string OrtClient::GetCachedModelPath(GstOrtOptimizationLevel opti_level, GstOrtExecutionProvider provider, int device_id) {
+  GStatBuf model_stat;
+  if (g_stat(onnx_model_path.c_str(), &model_stat) != 0) {
+    return "";
+  }
+  std::string options = std::string(OrtGetApiBase()->GetVersionString()) + ":" + std::to_string(opti_level) + ":" + std::to_string(provider) + ":" + std::to_string(device_id);
+  // The optimized graph depends on which nodes the provider claimed, which provider options affect
+  options += ":" + std::to_string(provider_options.dnnl_use_arena) + ":" + std::to_string(provider_options.xnnpack_threads) + ":" + provider_options.openvino_device_type;
+  gchar *basename = g_path_get_basename(onnx_model_path.c_str());
+  std::string name_prefix = std::string(basename) + "-";
+  g_free(basename);
+
+  char *model_path = realpath(onnx_model_path.c_str(), NULL);
+  std::string index_source = std::string(model_path ? model_path : onnx_model_path) + ":" + options;
+  free(model_path);
+  gchar *index_key = g_compute_checksum_for_string(G_CHECKSUM_SHA256, index_source.c_str(), -1);
+  gchar *index_path = g_build_filename(cache_dir.c_str(), (name_prefix + index_key + ".key").c_str(), NULL);
+  g_free(index_key);
+  std::string model_version = std::to_string(model_stat.st_size) + ":" + std::to_string(model_stat.st_mtim.tv_sec) + "." + std::to_string(model_stat.st_mtim.tv_nsec);
+  std::string indexed_version;
+  std::string indexed_key;
+  std::ifstream index_file(index_path);
+  index_file >> indexed_version >> indexed_key;
+  index_file.close();
+
+  std::string key;
+  if (!indexed_key.empty() && indexed_version == model_version) {
+    key = indexed_key;
+  } else {
+    key = HashModelFile(onnx_model_path, options);
+    if (!key.empty() && g_mkdir_with_parents(cache_dir.c_str(), 0755) == 0) {
+      // Write to temporary file first so that concurrent starts never read a partial entry
+      std::string temp_path = std::string(index_path) + ".tmp" + std::to_string(getpid());
+      std::ofstream temp_file(temp_path);
+      temp_file << model_version << " " << key << std::endl;
+      temp_file.close();
+      if (!temp_file.good() || g_rename(temp_path.c_str(), index_path) != 0) {
+        GST_WARNING ("Unable to store cache index %s", index_path);
+        g_unlink(temp_path.c_str());
+      }
+    }
+    if (!key.empty() && !indexed_key.empty() && indexed_key != key) {
+      // Model file changed since it was last cached
+      gchar *outdated_path = g_build_filename(cache_dir.c_str(), (name_prefix + indexed_key + ".ort").c_str(), NULL);
+      g_unlink(outdated_path);
+      g_free(outdated_path);
+    }
+  }
+  g_free(index_path);
+  if (key.empty()) {
+    return "";
+  }
+
+  gchar *path = g_build_filename(cache_dir.c_str(), (name_prefix + key + ".ort").c_str(), NULL);
+  std::string cached_model_path = path;
+  g_free(path);
+  return cached_model_path;
+}
+
+/**
+ * @brief Creates session from cached ORT format model if present. Otherwise creates
+ * session from ONNX model, saving the optimized graph to the cache. Apart from
+ * the entry of a model file's previous contents (see GetCachedModelPath),
+ * entries are never removed, as other clients sharing the cache directory
+ * (with other options) may still use them. With a
+ * session pool, only the first session optimizes the ONNX model; the others
+ * load the cached result.
+ * 
+ * @param cached_model_path path to cached model.
+ * @return true if session was created.
+ * @return false otherwise, in which case caller should create session without cache.
+ */
+bool OrtClient::CreateCachedSession(std::string const& cached_model_path) {
+  if (g_file_test(cached_model_path.c_str(), G_FILE_TEST_IS_REGULAR)) {
+    try {
+      Ort::SessionOptions cached_options = session_options.Clone();
+      cached_options.AddConfigEntry("session.load_model_format", "ORT");
+      LoadSessions(cached_model_path, cached_options, true, 0, sessions.size());
+      GST_INFO ("Loaded cached model %s", cached_model_path.c_str());
+      return true;
+    } catch (Ort::Exception& e) {
+      GST_WARNING ("Discarding unusable cached model %s: %s", cached_model_path.c_str(), e.what());
+      g_unlink(cached_model_path.c_str());
+    }
+  }
+  if (g_mkdir_with_parents(cache_dir.c_str(), 0755) != 0) {
+    GST_WARNING ("Unable to create cache directory %s", cache_dir.c_str());
+    return false;
+  }
+  // Write to temporary file first so that concurrent starts never load a partial model
+  std::string temp_path = cached_model_path + ".tmp" + std::to_string(getpid());
+  try {
+    Ort::SessionOptions save_options = session_options.Clone();
+    save_options.SetOptimizedModelFilePath(temp_path.c_str());
+    save_options.AddConfigEntry("session.save_model_format", "ORT");
+    LoadSessions(onnx_model_path, save_options, false, 0, 1);
+  } catch (Ort::Exception& e) {
+    GST_WARNING ("Unable to cache optimized model: %s", e.what());
+    g_unlink(temp_path.c_str());
+    return false;
+  }
+  if (g_rename(temp_path.c_str(), cached_model_path.c_str()) != 0) {
+    GST_WARNING ("Unable to store cached model %s", cached_model_path.c_str());
+    g_unlink(temp_path.c_str());
+    LoadSessions(onnx_model_path, session_options, false, 1, sessions.size());
+  } else {
+    GST_INFO ("Cached optimized model to %s", cached_model_path.c_str());
+    Ort::SessionOptions cached_options = session_options.Clone();
+    cached_options.AddConfigEntry("session.load_model_format", "ORT");
+    LoadSessions(cached_model_path, cached_options, true, 1, sessions.size());
+  }
+  // Sessions are usable regardless of whether caching succeeded
+  return true;
+}
+
+/**
+ * @brief Sets options for optional execution providers. Must be called before Init.
+ * 
+ * @param options provider-specific options.
+ */
+void OrtClient::SetProviderOptions(ProviderOptions const& options) {
+  provider_options = options;
+}
+
+/**
+ * @param name ORT execution provider name, e.g. "XnnpackExecutionProvider".
+ * @return true if the ORT library in use was built with the provider.
+ * @return false otherwise.
+ */
+static bool IsProviderAvailable(std::string const& name) {
+  std::vector<std::string> available = Ort::GetAvailableProviders();
+  return std::find(available.begin(), available.end(), name) != available.end();
+}
+
+/**
+ * @brief Appends execution provider to session options. CPU-oriented providers
+ * that are unavailable (at build or run time) fall back to the default CPU provider.
+ * 
+ * @param provider ORT execution provider.
+ * @param device_id hardware acceleration device ID.
+ * @return true if provider (or CPU fallback) was set up.
+ * @return false if provider could not be set up.
+ */
+bool OrtClient::AppendExecutionProvider(GstOrtExecutionProvider provider, int device_id) {
+  const char *fallback = NULL;
+  switch (provider) {
+    case GST_ORT_EXECUTION_PROVIDER_CUDA:
+#ifdef GST_ML_ONNX_RUNTIME_HAVE_CUDA
+      Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(session_options, device_id));
+#else 
+      GST_ERROR ("Unable to setup CUDA execution provider!");
+      return false;
+#endif
+      break;
+    case GST_ORT_EXECUTION_PROVIDER_DNNL:
+#ifdef GST_ML_ONNX_RUNTIME_HAVE_DNNL
+      if (IsProviderAvailable("DnnlExecutionProvider")) {
+        Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_Dnnl(session_options, provider_options.dnnl_use_arena ? 1 : 0));
+        break;
+      }
+#endif
+      fallback = "DNNL";
+      break;
+    case GST_ORT_EXECUTION_PROVIDER_XNNPACK:
+#ifdef GST_ML_ONNX_RUNTIME_HAVE_XNNPACK
+      if (IsProviderAvailable("XnnpackExecutionProvider")) {
+        // XNNPACK uses its own thread pool; avoid ORT's intra-op threads spinning alongside it
+        session_options.AddConfigEntry("session.intra_op.allow_spinning", "0");
+        std::unordered_map<std::string, std::string> xnnpack_options;
+        if (provider_options.xnnpack_threads > 0) {
+          xnnpack_options["intra_op_num_threads"] = std::to_string(provider_options.xnnpack_threads);
+        }
+        session_options.AppendExecutionProvider("XNNPACK", xnnpack_options);
+        break;
+      }
+#endif
+      fallback = "XNNPACK";
+      break;
+    case GST_ORT_EXECUTION_PROVIDER_OPENVINO:
+#ifdef GST_ML_ONNX_RUNTIME_HAVE_OPENVINO
+      if (IsProviderAvailable("OpenVINOExecutionProvider")) {
+        OrtOpenVINOProviderOptions openvino_options;
+        openvino_options.device_type = provider_options.openvino_device_type.c_str();
+        session_options.AppendExecutionProvider_OpenVINO(openvino_options);
+        break;
+      }
+#endif
+      fallback = "OpenVINO";
+      break;
+    case GST_ORT_EXECUTION_PROVIDER_CPU:
+      break;
+    default:
+      break;
+  }
+  if (fallback) {
+    GST_WARNING ("%s execution provider is not available, falling back to CPU", fallback);
+  }
+  execution_provider = fallback ? GST_ORT_EXECUTION_PROVIDER_CPU : provider;
+  return true;
+}
+
 /**
  * @brief Set up ONNX Runtime session options, and create new session.
  * 
@@ -75,21 +560,24 @@ bool OrtClient::CreateSession(GstOrtOptimizationLevel opti_level, GstOrtExecutio
         session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
         break;
     }
-    switch (provider) {
-      case GST_ORT_EXECUTION_PROVIDER_CUDA:
-#ifdef GST_ML_ONNX_RUNTIME_HAVE_CUDA
-        Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(session_options, device_id));
-#else 
-        GST_ERROR ("Unable to setup CUDA execution provider!");
-        return false;
-#endif
-        break;
-      case GST_ORT_EXECUTION_PROVIDER_CPU:
-        break;
-      default:
-        break;
+    if (!AppendExecutionProvider(provider, device_id)) {
+      return false;
     }
-    session = Ort::Session(env, onnx_model_path.c_str(), session_options);
+    if (num_sessions > 1) {
+      // Weights prepacked by one session's kernels are reused by the others
+      prepacked_weights = Ort::PrepackedWeightsContainer();
+      GST_INFO ("Creating pool of %d sessions with %d threads each%s", num_sessions, session_threads, pin_session_threads ? ", pinned" : "");
+    }
+    if (mmap_model && cache_dir.empty()) {
+      GST_WARNING ("Memory-mapped loading requires a cache directory, loading ONNX model normally");
+    }
+    if (!cache_dir.empty()) {
+      std::string cached_model_path = GetCachedModelPath(opti_level, provider, device_id);
+      if (!cached_model_path.empty() && CreateCachedSession(cached_model_path)) {
+        return true;
+      }
+    }
+    LoadSessions(onnx_model_path, session_options, false, 0, sessions.size());
     return true;
   } catch (Ort::Exception& e) {
     GST_ERROR ("%s\n", e.what());
@@ -105,6 +593,8 @@ bool OrtClient::CreateSession(GstOrtOptimizationLevel opti_level, GstOrtExecutio
  */
 bool OrtClient::SetModelInputOutput() {
   try {
+    // Sessions of a pool share the same model, so the first one is representative
+    Ort::Session& session = sessions[0]->session;
     num_input_nodes = session.GetInputCount();
     input_node_names = std::vector<const char*>(num_input_nodes);
     input_node_dims = std::vector<std::vector<int64_t>>(num_input_nodes);
@@ -120,12 +610,21 @@ bool OrtClient::SetModelInputOutput() {
       Ort::TypeInfo type_info = session.GetInputTypeInfo(i);
       auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
       input_node_dims[i] = tensor_info.GetShape();
+      input_element_type = tensor_info.GetElementType();
     }
     // Object detection model should only take in one input node (e.g. an image)
     assert(input_node_dims.size() == 1);
-    // Fix variable batch size (batch size of -1), as we process a single frame at a time
+    if (input_element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT && input_element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 && input_element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8) {
+      GST_ERROR ("Unsupported model input element type %d!", input_element_type);
+      return false;
+    }
+    model_input_dims = input_node_dims[0];
+    // Fix variable batch size (batch size of -1) to number of tiles per frame
     if (input_node_dims[0][0] == -1) {
-      input_node_dims[0][0] = 1;
+      input_node_dims[0][0] = batch_size;
+    } else if (input_node_dims[0][0] != (int64_t) batch_size) {
+      GST_ERROR ("Model has a fixed batch size of %" G_GINT64_FORMAT ", but %zu tiles per frame were requested!", input_node_dims[0][0], batch_size);
+      return false;
     }
     // Output nodes
     for (size_t i = 0; i < num_output_nodes; i++) {
@@ -136,13 +635,148 @@ bool OrtClient::SetModelInputOutput() {
       auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
       output_node_dims[i] = tensor_info.GetShape();
     }
-    return true;
+    // Class count (and with it the label count) follows from the output shapes
+    if (!model->SetOutputShapes(output_node_dims)) {
+      return false;
+    }
+    return ResolveInputSize();
   } catch (Ort::Exception& e) {
     GST_ERROR ("%s\n", e.what());
     return false;
   }
 }
 
+/**
+ * @brief Resolves input height/width from the requested input size and the
+ * model's (possibly dynamic) input axes. Updates the input node dims and the
+ * object detection model's preprocessing dimensions. Context input tensor caches
+ * follow on their next use. Caller must hold config_lock exclusively once the
+ * client is in use.
+ * 
+ * @return true if requested size is compatible with the model.
+ * @return false otherwise.
+ */
+bool OrtClient::ResolveInputSize() {
+  std::vector<int64_t>& dims = input_node_dims[0];
+  if (dims.size() != 4) {
+    GST_ERROR ("Expected 4D image input, got %zu dimensions!", dims.size());
+    return false;
+  }
+  size_t h_index = model->IsChannelsLast() ? 1 : 2;
+  size_t w_index = model->IsChannelsLast() ? 2 : 3;
+  int64_t height = model_input_dims[h_index];
+  int64_t width = model_input_dims[w_index];
+  if (input_size > 0) {
+    // Fixed axes must match requested size
+    if ((height != -1 && height != input_size) || (width != -1 && width != input_size)) {
+      GST_ERROR ("Model has fixed input size %" G_GINT64_FORMAT "x%" G_GINT64_FORMAT ", unable to use input size %d!", width, height, input_size);
+      return false;
+    }
+    height = input_size;
+    width = input_size;
+  } else {
+    // Dynamic axes fall back to model's default size
+    height = (height == -1) ? model->GetInputHeight() : height;
+    width = (width == -1) ? model->GetInputWidth() : width;
+  }
+  if (!model->SetInputSize(width, height)) {
+    return false;
+  }
+  dims[h_index] = height;
+  dims[w_index] = width;
+  input_tensor_size = model->GetInputTensorSize() * batch_size;
+  return true;
+}
+
+/**
+ * @brief Creates input tensor over a context's internal tensor cache matching
+ * the model's input element type. Does not copy data.
+ * 
+ * @param ctx context whose tensor cache to use.
+ * @param memory_info CPU memory info.
+ * @param num_frames number of frames batched in the tensor cache.
+ * @return Ort::Value input tensor.
+ */
+Ort::Value OrtClient::CreateInputTensor(InferenceContext& ctx, Ort::MemoryInfo const& memory_info, size_t num_frames) {
+  std::vector<int64_t> dims = input_node_dims[0];
+  dims[0] *= num_frames;
+  size_t size = input_tensor_size * num_frames;
+  switch (input_element_type) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+      return Ort::Value::CreateTensor<uint8_t>(memory_info, ctx.input_tensor_bytes.data(), size, dims.data(), dims.size());
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+      return Ort::Value::CreateTensor(memory_info, ctx.input_tensor_halves.data(), size * sizeof(Ort::Float16_t), dims.data(), dims.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
+    default:
+      return Ort::Value::CreateTensor<float>(memory_info, ctx.input_tensor_values.data(), size, dims.data(), dims.size());
+  }
+}
+
+/**
+ * @brief Takes an idle inference context from the pool, or creates one if all
+ * are in use.
+ * 
+ * @param num_frames number of frames to size the context's tensor cache for (0 to leave as is).
+ * @return std::unique_ptr<InferenceContext> context, to be returned with ReleaseContext.
+ */
+std::unique_ptr<InferenceContext> OrtClient::AcquireContext(size_t num_frames) {
+  std::unique_ptr<InferenceContext> ctx;
+  {
+    std::lock_guard<std::mutex> guard(context_lock);
+    if (!contexts.empty()) {
+      ctx = std::move(contexts.back());
+      contexts.pop_back();
+    }
+  }
+  if (!ctx) {
+    ctx = std::unique_ptr<InferenceContext>(new InferenceContext());
+    ctx->model_context = model->CreateContext();
+  }
+  if (num_frames == 0) {
+    return ctx;
+  }
+  switch (input_element_type) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+      ctx->input_tensor_bytes.resize(input_tensor_size * num_frames);
+      break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+      ctx->input_tensor_halves.resize(input_tensor_size * num_frames);
+      break;
+    default:
+      ctx->input_tensor_values.resize(input_tensor_size * num_frames);
+      break;
+  }
+  return ctx;
+}
+
+void OrtClient::ReleaseContext(std::unique_ptr<InferenceContext> ctx) {
+  std::lock_guard<std::mutex> guard(context_lock);
+  contexts.push_back(std::move(ctx));
+}
+
+/**
+ * @brief Picks the least-loaded session of the pool, starting the search at
+ * the next session in round-robin order so that ties are spread evenly.
+ * 
+ * @return SessionSlot& session to run on, to be released with ReleaseSession.
+ */
+SessionSlot& OrtClient::AcquireSession() {
+  size_t count = sessions.size();
+  size_t start = next_session++ % count;
+  SessionSlot *best = sessions[start].get();
+  for (size_t i = 1; i < count && best->pending > 0; i++) {
+    SessionSlot *slot = sessions[(start + i) % count].get();
+    if (slot->pending < best->pending) {
+      best = slot;
+    }
+  }
+  best->pending++;
+  return *best;
+}
+
+void OrtClient::ReleaseSession(SessionSlot& slot) {
+  slot.pending--;
+}
+
 /**
  * @brief Loads class labels from label file.
  * 
@@ -190,14 +824,20 @@ bool OrtClient::Init(std::string const& model_path, std::string const& label_pat
     case GST_ORT_DETECTION_MODEL_YOLOV4:
       model = std::unique_ptr<ObjectDetectionModel>(new YOLOv4());
       break;
+    case GST_ORT_DETECTION_MODEL_YOLOV8:
+      model = std::unique_ptr<ObjectDetectionModel>(new YOLOv8());
+      break;
     default: 
       // Default model is YOLOv4
       model = std::unique_ptr<ObjectDetectionModel>(new YOLOv4());
       break;
   }
-  input_tensor_size = model->GetInputTensorSize();
-  // Set up internal tensor value vector (acts as a cache)
-  input_tensor_values = std::vector<float>(input_tensor_size);
+  model->SetTiling(tile_rows, tile_cols, tile_overlap);
+  batch_size = model->GetBatchSize();
+  sessions.clear();
+  for (int i = 0; i < num_sessions; i++) {
+    sessions.emplace_back(new SessionSlot());
+  }
   if (!CreateSession(opti_level, provider, device_id) || !SetModelInputOutput() || !LoadClassLabels()) {
     is_init = false;
     return false;
@@ -207,31 +847,208 @@ bool OrtClient::Init(std::string const& model_path, std::string const& label_pat
 }
 
 /**
- * @brief Runs object detection model on input data.
- * Input data is modified in-place.
+ * @brief Runs inference on a blank input tensor, so that memory arenas and
+ * kernels are warmed up before the first real frame.
  * 
- * @param data input image data.
- * @param width image width.
- * @param height image height.
- * @param rgb is image RGB or BGR format.
+ * @param iterations number of warm-up inferences.
+ * @return true if warm-up inferences succeeded.
+ * @return false otherwise.
+ */
+bool OrtClient::Warmup(int iterations) {
+  if (!is_init) {
+    GST_ERROR ("Unable to warm up ORT client that has not been initialized!");
+    return false;
+  }
+  try {
+    std::shared_lock<std::shared_timed_mutex> config_guard(config_lock);
+    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::unique_ptr<InferenceContext> ctx = AcquireContext(1);
+    std::fill(ctx->input_tensor_values.begin(), ctx->input_tensor_values.end(), 0.0f);
+    std::fill(ctx->input_tensor_bytes.begin(), ctx->input_tensor_bytes.end(), 0);
+    std::fill(ctx->input_tensor_halves.begin(), ctx->input_tensor_halves.end(), Ort::Float16_t{});
+    // Every session of a pool has its own arena and kernels to warm up
+    for (auto& slot : sessions) {
+      for (int i = 0; i < iterations; i++) {
+        Ort::Value input_tensor = CreateInputTensor(*ctx, memory_info, 1);
+        slot->session.Run(Ort::RunOptions{nullptr}, input_node_names.data(), &input_tensor, num_input_nodes, output_node_names.data(), num_output_nodes);
+      }
+    }
+    ReleaseContext(std::move(ctx));
+    return true;
+  } catch (Ort::Exception& e) {
+    GST_ERROR ("%s\n", e.what());
+    return false;
+  }
+}
+
+// Class labels of the model, indexed by Detection::class_index
+std::vector<std::string> const& OrtClient::GetClassLabels() {
+  return labels;
+}
+
+/**
+ * @return true if several frames may be passed to the model in one batch.
+ */
+bool OrtClient::HasDynamicBatchSize() {
+  return is_init && model_input_dims[0] == -1;
+}
+
+/**
+ * @brief Detects objects in frames with a single session run, batching the
+ * frames' tiles together. Caller must hold config_lock (shared).
+ * 
+ * @param frames frames to process.
+ * @param count number of frames.
+ * @param results results buffer, already reset to hold the frames' detections.
+ * @param first index of the first frame within results.
  * @param score_threshold score threshold when filtering bounding boxes.
  * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @return true if inference succeeded.
+ * @return false otherwise.
  */
-void OrtClient::RunModel(uint8_t *const data, int width, int height, bool is_rgb, float score_threshold, float nms_threshold) {
-  if (!is_init) {
-    GST_ERROR ("Unable to run inference when ORT client has not been initialized!");
-    return;
+bool OrtClient::RunFrames(DetectionFrame const *frames, size_t count, DetectionResults& results, size_t first, float score_threshold, float nms_threshold) {
+  // One context per frame for model state; the first also holds the batched input tensor
+  std::vector<std::unique_ptr<InferenceContext>> ctxs;
+  ctxs.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    ctxs.push_back(AcquireContext(i == 0 ? count : 0));
   }
+  InferenceContext& input_ctx = *ctxs[0];
+  SessionSlot& slot = AcquireSession();
+  DetectionTimings& timings = results.GetTimings();
+  bool res = true;
   try {
     auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    model->Preprocess(data, input_tensor_values, width, height, is_rgb);
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, input_tensor_values.data(), input_tensor_size, input_node_dims[0].data(), input_node_dims[0].size());
+    gint64 start = g_get_monotonic_time ();
+    for (size_t i = 0; i < count; i++) {
+      DetectionFrame const& frame = frames[i];
+      ModelContext& model_context = *ctxs[i]->model_context;
+      size_t offset = i * input_tensor_size;
+      switch (input_element_type) {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+          // Quantized models taking uint8 input skip float conversion entirely
+          model->Preprocess(model_context, frame.data, input_ctx.input_tensor_bytes.data() + offset, frame.width, frame.height, frame.is_rgb);
+          break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+          model->Preprocess(model_context, frame.data, input_ctx.input_tensor_halves.data() + offset, frame.width, frame.height, frame.is_rgb);
+          break;
+        default:
+          model->Preprocess(model_context, frame.data, input_ctx.input_tensor_values.data() + offset, frame.width, frame.height, frame.is_rgb);
+          break;
+      }
+    }
+    Ort::Value input_tensor = CreateInputTensor(input_ctx, memory_info, count);
     assert(input_tensor.IsTensor());
-    std::vector<Ort::Value> model_output = session.Run(Ort::RunOptions{nullptr}, input_node_names.data(), &input_tensor, num_input_nodes, output_node_names.data(), num_output_nodes);
-    model->Postprocess(model_output, labels, score_threshold, nms_threshold);
+    gint64 preprocessed = g_get_monotonic_time ();
+    timings.preprocess_us += preprocessed - start;
+    if (!timings.preprocess_start_us) {
+      timings.preprocess_start_us = start;
+      timings.run_start_us = preprocessed;
+    }
+    std::vector<Ort::Value> model_output = slot.session.Run(Ort::RunOptions{nullptr}, input_node_names.data(), &input_tensor, num_input_nodes, output_node_names.data(), num_output_nodes);
+    gint64 ran = g_get_monotonic_time ();
+    timings.run_us += ran - preprocessed;
+    if (!timings.postprocess_start_us) {
+      timings.postprocess_start_us = ran;
+    }
+    for (size_t i = 0; i < count; i++) {
+      model->Postprocess(*ctxs[i]->model_context, model_output, i * batch_size, score_threshold, nms_threshold, results.GetDetections(first + i));
+    }
+    timings.postprocess_us += g_get_monotonic_time () - ran;
   } catch (Ort::Exception& e) {
     GST_ERROR ("%s\n", e.what());
+    res = false;
   }
+  ReleaseSession(slot);
+  for (auto& ctx : ctxs) {
+    ReleaseContext(std::move(ctx));
+  }
+  return res;
+}
+
+/**
+ * @brief Detects objects in a frame. Frame data is not modified.
+ * May be called from several threads concurrently.
+ * 
+ * @param frame frame to process.
+ * @param results out-param holding the frame's detections (index 0) on return.
+ * @param score_threshold score threshold when filtering bounding boxes.
+ * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @return true if inference succeeded.
+ * @return false otherwise.
+ */
+bool OrtClient::Detect(DetectionFrame const& frame, DetectionResults& results, float score_threshold, float nms_threshold) {
+  results.Reset(1);
+  if (!is_init) {
+    GST_ERROR ("Unable to run inference when ORT client has not been initialized!");
+    return false;
+  }
+  std::shared_lock<std::shared_timed_mutex> config_guard(config_lock);
+  return RunFrames(&frame, 1, results, 0, score_threshold, nms_threshold);
+}
+
+/**
+ * @brief Detects objects in several frames. For models with a dynamic batch
+ * size, all frames are inferenced in a single session run; otherwise frames
+ * are run one after another. Frame data is not modified.
+ * 
+ * @param frames frames to process.
+ * @param results out-param holding each frame's detections (by frame index) on return.
+ * @param score_threshold score threshold when filtering bounding boxes.
+ * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @return true if inference succeeded for all frames.
+ * @return false otherwise.
+ */
+bool OrtClient::DetectBatch(std::vector<DetectionFrame> const& frames, DetectionResults& results, float score_threshold, float nms_threshold) {
+  results.Reset(frames.size());
+  if (!is_init) {
+    GST_ERROR ("Unable to run inference when ORT client has not been initialized!");
+    return false;
+  }
+  if (frames.empty()) {
+    return true;
+  }
+  std::shared_lock<std::shared_timed_mutex> config_guard(config_lock);
+  if (HasDynamicBatchSize()) {
+    return RunFrames(frames.data(), frames.size(), results, 0, score_threshold, nms_threshold);
+  }
+  bool res = true;
+  for (size_t i = 0; i < frames.size(); i++) {
+    res = RunFrames(&frames[i], 1, results, i, score_threshold, nms_threshold) && res;
+  }
+  return res;
+}
+
+/**
+ * @brief Runs object detection model on input data, drawing detections onto it.
+ * Input data is modified in-place. May be called from several threads
+ * concurrently; calls are spread over the session pool.
+ * 
+ * @param data input image data.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ * @param score_threshold score threshold when filtering bounding boxes.
+ * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @param timings optional out-param for the time spent in each stage.
+ * @return size_t number of detections drawn.
+ */
+size_t OrtClient::RunModel(uint8_t *const data, int width, int height, bool is_rgb, float score_threshold, float nms_threshold, DetectionTimings *timings) {
+  // Reused by each thread's calls, so that steady-state detection does not allocate
+  static thread_local DetectionResults results;
+  DetectionFrame frame{data, width, height, is_rgb};
+  size_t num_detections = 0;
+  if (Detect(frame, results, score_threshold, nms_threshold)) {
+    gint64 start = g_get_monotonic_time ();
+    DrawDetections(frame, results.GetDetections(0), labels);
+    results.GetTimings().draw_us = g_get_monotonic_time () - start;
+    results.GetTimings().draw_start_us = start;
+    num_detections = results.GetDetections(0).size();
+  }
+  if (timings) {
+    *timings = results.GetTimings();
+  }
+  return num_detections;
 }
 
 /**
@@ -242,17 +1059,17 @@ void OrtClient::RunModel(uint8_t *const data, int width, int height, bool is_rgb
  * @param vmeta GStreamer video meta for current frame.
  * @param score_threshold score threshold when filtering bounding boxes.
  * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @param timings optional out-param for the time spent in each stage.
+ * @return size_t number of detections drawn.
  */
-void OrtClient::RunModel(uint8_t *const data, GstVideoMeta *vmeta, float score_threshold, float nms_threshold) {
+size_t OrtClient::RunModel(uint8_t *const data, GstVideoMeta *vmeta, float score_threshold, float nms_threshold, DetectionTimings *timings) {
   switch (vmeta->format) {
     case GST_VIDEO_FORMAT_RGB:
-      RunModel(data, vmeta->width, vmeta->height, true, score_threshold, nms_threshold);
-      break;
+      return RunModel(data, vmeta->width, vmeta->height, true, score_threshold, nms_threshold, timings);
     case GST_VIDEO_FORMAT_BGR:
-      RunModel(data, vmeta->width, vmeta->height, false, score_threshold, nms_threshold);
-      break; 
+      return RunModel(data, vmeta->width, vmeta->height, false, score_threshold, nms_threshold, timings);
     default:
       GST_ERROR ("Unable to recognize color format!");
-      break;
+      return 0;
   }
 }
\ No newline at end of file
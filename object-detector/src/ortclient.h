@@ -22,54 +22,157 @@
 #ifndef __ORT_CLIENT_H__
 #define __ORT_CLIENT_H__
 
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <onnxruntime_cxx_api.h>
 #include "objectdetectionmodel.h"
+#include "detection.h"
 #include "gstortelement.h"
 
+// Options for optional (non-default) execution providers
+struct ProviderOptions {
+  // oneDNN: use memory arena
+  bool dnnl_use_arena = true;
+  // XNNPACK: size of XNNPACK thread pool (0 = ORT default)
+  int xnnpack_threads = 0;
+  // OpenVINO: target device type
+  std::string openvino_device_type = "CPU_FP32";
+};
+
+// Session of a session pool
+struct SessionSlot {
+  Ort::Session session{nullptr};
+  // Number of callers currently running on this session
+  std::atomic<int> pending{0};
+};
+
+// Profile written by a session of the pool (see SetProfiling)
+struct SessionProfile {
+  std::string path;
+  // Profiling start, in system clock nanoseconds; event timestamps are microseconds relative to it
+  uint64_t start_ns;
+};
+
+// Per-call state of a RunModel call: model scratch state and input tensor cache,
+// one of which is used depending on model input element type.
+// Contexts are pooled and reused across calls.
+struct InferenceContext {
+  std::unique_ptr<ModelContext> model_context;
+  std::vector<float> input_tensor_values;
+  std::vector<uint8_t> input_tensor_bytes;
+  std::vector<Ort::Float16_t> input_tensor_halves;
+};
+
 /**
  * @brief ONNX Runtime client. Able to run object-detection
  * inferencing sessions with an object detection model.
+ * Once initialized, Detect, DetectBatch and RunModel may be called from
+ * any number of threads concurrently; each call uses its own pooled
+ * InferenceContext.
  */
 class OrtClient {
   private:
     Ort::Env env;
-    Ort::Session session{nullptr};
+    // Session pool; a single session unless SetSessionPool was called
+    std::vector<std::unique_ptr<SessionSlot>> sessions;
+    std::atomic<unsigned int> next_session{0};
+    Ort::PrepackedWeightsContainer prepacked_weights{nullptr};
 
     // This seems to prevent inferencing to occur within plugin:
     // Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
 
+    // Model configuration, shared by all calls (per-call state is in InferenceContext)
     std::unique_ptr<ObjectDetectionModel> model;
     std::string onnx_model_path;
     std::string class_labels_path;
     std::vector<std::string> labels;
 
     size_t input_tensor_size;
+    size_t batch_size;
     std::vector<Ort::AllocatedStringPtr> stored_names; // Needed to make sure unique_ptrs don't go out of scope
     size_t num_input_nodes;
     std::vector<const char*> input_node_names;
     std::vector<std::vector<int64_t>> input_node_dims;
+    std::vector<int64_t> model_input_dims; // Input dims as exported, -1 for dynamic axes
     size_t num_output_nodes;
     std::vector<const char*> output_node_names;
     std::vector<std::vector<int64_t>> output_node_dims;
 
-    std::vector<float> input_tensor_values;
+    // Determines which of each context's input tensor caches is used
+    ONNXTensorElementDataType input_element_type;
+    // Idle inference contexts (protected by context_lock)
+    std::vector<std::unique_ptr<InferenceContext>> contexts;
+    std::mutex context_lock;
+    // Held shared by RunModel calls, and exclusively when changing the input size
+    std::shared_timed_mutex config_lock;
 
     Ort::SessionOptions session_options;
     Ort::AllocatorWithDefaultOptions allocator;
 
     bool is_init;
 
+    // Tiling configuration, applied to model on Init
+    int tile_rows;
+    int tile_cols;
+    float tile_overlap;
+    // Directory for cached optimized (ORT format) models, empty to disable caching
+    std::string cache_dir;
+    // Memory-map cached ORT format model instead of reading it into private memory
+    bool mmap_model;
+    std::vector<GMappedFile*> mapped_models;
+    ProviderOptions provider_options;
+    // Provider sessions were created with (CPU if the requested one fell back)
+    GstOrtExecutionProvider execution_provider;
+    // Requested model input size (0 to use model's own dimensions)
+    int input_size;
+    // Session pool configuration, applied on Init
+    int num_sessions;
+    int session_threads;
+    bool pin_session_threads;
+    // ORT profile file prefix, empty when profiling is disabled
+    std::string profile_prefix;
+
     bool LoadClassLabels();
     bool SetModelInputOutput();
+    bool ResolveInputSize();
+    Ort::Value CreateInputTensor(InferenceContext& ctx, Ort::MemoryInfo const& memory_info, size_t num_frames);
+    void ConfigureSessionThreads(Ort::SessionOptions& options, size_t index);
+    SessionSlot& AcquireSession();
+    void ReleaseSession(SessionSlot& slot);
+    std::unique_ptr<InferenceContext> AcquireContext(size_t num_frames);
+    void ReleaseContext(std::unique_ptr<InferenceContext> ctx);
+    bool RunFrames(DetectionFrame const *frames, size_t count, DetectionResults& results, size_t first, float score_threshold, float nms_threshold);
+    bool AppendExecutionProvider(GstOrtExecutionProvider provider, int device_id);
     bool CreateSession(GstOrtOptimizationLevel opti_level, GstOrtExecutionProvider provider, int device_id); 
+    std::string GetCachedModelPath(GstOrtOptimizationLevel opti_level, GstOrtExecutionProvider provider, int device_id);
+    bool CreateCachedSession(std::string const& cached_model_path);
+    void LoadSessions(std::string const& path, Ort::SessionOptions const& options, bool ort_format, size_t first, size_t last);
 
   public:
     OrtClient();
-    ~OrtClient() = default;
+    ~OrtClient();
     bool Init(std::string const& model_path, std::string const& label_path, GstOrtOptimizationLevel = GST_ORT_OPTIMIZATION_LEVEL_ENABLE_EXTENDED, GstOrtExecutionProvider = GST_ORT_EXECUTION_PROVIDER_CPU, GstOrtDetectionModel = GST_ORT_DETECTION_MODEL_YOLOV4, int = 0);
     bool IsInitialized();
-    void RunModel(uint8_t *const data, int width, int height, bool is_rgb, float = 0.25, float = 0.213);
-    void RunModel(uint8_t *const data, GstVideoMeta *vmeta, float = 0.25, float = 0.213);
+    bool Warmup(int iterations);
+    void SetTiling(int rows, int cols, float overlap);
+    bool SetInputSize(int size);
+    void SetCacheDir(std::string const& dir);
+    void SetMemoryMapModel(bool enable);
+    void SetProviderOptions(ProviderOptions const& options);
+    void SetSessionPool(int count, int threads_per_session, bool pin_threads);
+    int GetNumSessions();
+    GstOrtExecutionProvider GetExecutionProvider();
+    void SetProfiling(std::string const& prefix);
+    std::vector<SessionProfile> EndProfiling();
+    int GetInputSize();
+    bool HasDynamicInputSize();
+    bool HasDynamicBatchSize();
+    std::vector<std::string> const& GetClassLabels();
+    bool Detect(DetectionFrame const& frame, DetectionResults& results, float = 0.25, float = 0.213);
+    bool DetectBatch(std::vector<DetectionFrame> const& frames, DetectionResults& results, float = 0.25, float = 0.213);
+    size_t RunModel(uint8_t *const data, int width, int height, bool is_rgb, float = 0.25, float = 0.213, DetectionTimings * = nullptr);
+    size_t RunModel(uint8_t *const data, GstVideoMeta *vmeta, float = 0.25, float = 0.213, DetectionTimings * = nullptr);
 };
 
 #endif
\ No newline at end of file
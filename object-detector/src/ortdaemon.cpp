@@ -0,0 +1,398 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ortdaemon.h"
+
+// Limits on client-provided region layout
+#define MAX_SLOTS 1024
+#define MAX_DETECTIONS 65536
+#define MAX_FRAME_SIZE (G_GUINT64_CONSTANT (1) << 30)
+// Poll interval while idle, bounding how long Stop takes to be noticed
+#define IDLE_POLL_TIMEOUT_US 100000
+
+OrtDaemon::OrtDaemon(OrtClient& ort_client) : ort_client(ort_client), listen_fd(-1), max_batch(8), batch_timeout_us(2000), stop_requested(false) {}
+
+OrtDaemon::~OrtDaemon() {
+  for (auto& connection : connections) {
+    Close(*connection);
+  }
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    unlink(socket_path.c_str());
+  }
+}
+
+/**
+ * @brief Sets how requests are batched. A batch is run once max_batch requests
+ * are waiting, or once the oldest has waited batch_timeout_us.
+ * 
+ * @param max_batch maximum number of frames per batch.
+ * @param batch_timeout_us time in microseconds to wait for other requests to batch with.
+ */
+void OrtDaemon::SetBatching(size_t max_batch, int64_t batch_timeout_us) {
+  this->max_batch = std::max<size_t>(max_batch, 1);
+  this->batch_timeout_us = std::max<int64_t>(batch_timeout_us, 0);
+}
+
+/**
+ * @brief Creates listening socket. A stale socket file left behind by a previous
+ * daemon is replaced, but not one a running daemon is listening on.
+ * 
+ * @param socket_path path of Unix socket to create.
+ * @return true if listening.
+ * @return false otherwise.
+ */
+bool OrtDaemon::Listen(std::string const& socket_path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    GST_ERROR ("Socket path '%s' is too long!", socket_path.c_str());
+    return false;
+  }
+  strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    GST_ERROR ("Unable to create socket: %s", g_strerror (errno));
+    return false;
+  }
+  if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+    GST_ERROR ("A daemon is already listening on '%s'!", socket_path.c_str());
+    close(fd);
+    return false;
+  }
+  unlink(socket_path.c_str());
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    GST_ERROR ("Unable to listen on '%s': %s", socket_path.c_str(), g_strerror (errno));
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  listen_fd = fd;
+  this->socket_path = socket_path;
+  return true;
+}
+
+/**
+ * @brief Requests Run to return. Safe to call from a signal handler or another thread.
+ */
+void OrtDaemon::Stop() {
+  stop_requested = true;
+}
+
+void OrtDaemon::Accept() {
+  int fd;
+  while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    std::unique_ptr<OrtDaemonConnection> connection(new OrtDaemonConnection());
+    connection->fd = fd;
+    connections.push_back(std::move(connection));
+    GST_INFO ("Client connected (%zu clients)", connections.size());
+  }
+}
+
+void OrtDaemon::Unmap(OrtDaemonConnection& connection) {
+  if (connection.region) {
+    munmap(connection.region, connection.region_size);
+    connection.region = nullptr;
+    connection.region_size = 0;
+  }
+}
+
+void OrtDaemon::Close(OrtDaemonConnection& connection) {
+  Unmap(connection);
+  if (connection.fd >= 0) {
+    close(connection.fd);
+    connection.fd = -1;
+  }
+}
+
+/**
+ * @brief Reads all control messages currently queued on a connection.
+ * 
+ * @param connection client connection.
+ * @return true if connection is still usable.
+ * @return false if client disconnected or violated the protocol.
+ */
+bool OrtDaemon::Receive(OrtDaemonConnection& connection) {
+  while (true) {
+    union {
+      OrtDaemonHello hello;
+      OrtDaemonMap map;
+      OrtDaemonDetect detect;
+      uint8_t bytes[128];
+    } message;
+    union {
+      char buffer[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr align;
+    } control;
+    struct iovec iov = {&message, sizeof(message)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    ssize_t size = recvmsg(connection.fd, &msg, MSG_CMSG_CLOEXEC);
+    if (size < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    if (size == 0) {
+      return false;
+    }
+    int memfd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) || (size_t) size < sizeof(uint32_t)) {
+      GST_WARNING ("Malformed message from client!");
+      if (memfd >= 0) {
+        close(memfd);
+      }
+      return false;
+    }
+
+    bool res;
+    switch (message.hello.type) {
+      case ORT_DAEMON_MSG_HELLO:
+        res = (size_t) size == sizeof(OrtDaemonHello) && HandleHello(connection, message.hello);
+        break;
+      case ORT_DAEMON_MSG_MAP:
+        res = (size_t) size == sizeof(OrtDaemonMap) && memfd >= 0 && HandleMap(connection, message.map, memfd);
+        break;
+      case ORT_DAEMON_MSG_DETECT:
+        res = (size_t) size == sizeof(OrtDaemonDetect) && HandleDetect(connection, message.detect);
+        break;
+      default:
+        res = false;
+        break;
+    }
+    if (memfd >= 0) {
+      close(memfd);
+    }
+    if (!res) {
+      GST_WARNING ("Unexpected message of type %u from client!", message.hello.type);
+      return false;
+    }
+  }
+}
+
+bool OrtDaemon::HandleHello(OrtDaemonConnection& connection, OrtDaemonHello const& hello) {
+  if (hello.version != ORT_DAEMON_PROTOCOL_VERSION) {
+    GST_WARNING ("Client uses protocol version %u, expected %u!", hello.version, ORT_DAEMON_PROTOCOL_VERSION);
+    return false;
+  }
+  std::string labels;
+  for (std::string const& label : ort_client.GetClassLabels()) {
+    labels += label;
+    labels += '\n';
+  }
+  std::vector<uint8_t> reply(sizeof(OrtDaemonReady));
+  OrtDaemonReady ready = {ORT_DAEMON_MSG_READY, 1, 0};
+  if (sizeof(OrtDaemonReady) + labels.size() <= ORT_DAEMON_MAX_MESSAGE_SIZE) {
+    ready.labels_size = labels.size();
+    reply.insert(reply.end(), labels.begin(), labels.end());
+  } else {
+    GST_ERROR ("Class labels do not fit in a control message!");
+    ready.status = 0;
+  }
+  memcpy(reply.data(), &ready, sizeof(ready));
+  if (send(connection.fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0) {
+    return false;
+  }
+  connection.ready = ready.status != 0;
+  return connection.ready;
+}
+
+bool OrtDaemon::HandleMap(OrtDaemonConnection& connection, OrtDaemonMap const& map, int memfd) {
+  if (!connection.ready) {
+    return false;
+  }
+  for (OrtDaemonRequest const& request : pending) {
+    if (request.connection == &connection) {
+      GST_WARNING ("Client remapped its region with requests in flight!");
+      return false;
+    }
+  }
+  if (map.num_slots == 0 || map.num_slots > MAX_SLOTS || map.max_detections > MAX_DETECTIONS || map.frame_size > MAX_FRAME_SIZE) {
+    GST_WARNING ("Unsupported region layout of %u slots of %" G_GUINT64_FORMAT " bytes!", map.num_slots, map.frame_size);
+    return false;
+  }
+  // The region must not shrink under us, or accessing it would raise SIGBUS
+  size_t region_size = map.num_slots * OrtDaemonSlotStride(map.frame_size, map.max_detections);
+  struct stat st;
+  int seals = fcntl(memfd, F_GET_SEALS);
+  if (seals < 0 || !(seals & F_SEAL_SHRINK) || fstat(memfd, &st) < 0 || (size_t) st.st_size < region_size) {
+    GST_WARNING ("Client region is not sealed against shrinking, or too small!");
+    return false;
+  }
+  void *region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (region == MAP_FAILED) {
+    GST_WARNING ("Unable to map client region: %s", g_strerror (errno));
+    return false;
+  }
+  Unmap(connection);
+  connection.region = (uint8_t *) region;
+  connection.region_size = region_size;
+  connection.num_slots = map.num_slots;
+  connection.max_detections = map.max_detections;
+  connection.frame_size = map.frame_size;
+  return true;
+}
+
+bool OrtDaemon::HandleDetect(OrtDaemonConnection& connection, OrtDaemonDetect const& detect) {
+  if (!connection.region || detect.slot >= connection.num_slots || detect.width <= 0 || detect.height <= 0
+      || (uint64_t) detect.width * detect.height * 3 > connection.frame_size) {
+    return false;
+  }
+  pending.push_back(OrtDaemonRequest{&connection, detect, g_get_monotonic_time ()});
+  return true;
+}
+
+/**
+ * @brief Writes a slot's detections and notifies client. A client that is not
+ * reading its replies is disconnected rather than blocking other clients.
+ */
+void OrtDaemon::Reply(OrtDaemonConnection& connection, uint32_t slot, bool status, std::vector<Detection> const& detections) {
+  size_t count = status ? std::min<size_t>(detections.size(), connection.max_detections) : 0;
+  uint8_t *slot_data = connection.region + slot * OrtDaemonSlotStride(connection.frame_size, connection.max_detections);
+  if (count > 0) {
+    memcpy(slot_data + OrtDaemonDetectionOffset(connection.frame_size), detections.data(), count * sizeof(Detection));
+  }
+  OrtDaemonDone done = {ORT_DAEMON_MSG_DONE, slot, status ? 1u : 0u, (uint32_t) count};
+  if (send(connection.fd, &done, sizeof(done), MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+    GST_WARNING ("Unable to reply to client: %s", g_strerror (errno));
+    connection.failed = true;
+  }
+}
+
+/**
+ * @brief Inferences the oldest waiting request together with all others (from any
+ * client) using the same thresholds, up to max_batch frames.
+ */
+void OrtDaemon::RunBatch() {
+  OrtDaemonDetect const& first = pending.front().detect;
+  float score_threshold = first.score_threshold;
+  float nms_threshold = first.nms_threshold;
+
+  batch_requests.clear();
+  batch_frames.clear();
+  size_t kept = 0;
+  for (size_t i = 0; i < pending.size(); i++) {
+    OrtDaemonRequest const& request = pending[i];
+    if (batch_requests.size() < max_batch && request.detect.score_threshold == score_threshold
+        && request.detect.nms_threshold == nms_threshold) {
+      OrtDaemonConnection& connection = *request.connection;
+      uint8_t *data = connection.region + request.detect.slot * OrtDaemonSlotStride(connection.frame_size, connection.max_detections);
+      batch_frames.push_back(DetectionFrame{data, request.detect.width, request.detect.height, request.detect.is_rgb != 0});
+      batch_requests.push_back(request);
+    } else {
+      pending[kept++] = request;
+    }
+  }
+  pending.resize(kept);
+
+  bool res = ort_client.DetectBatch(batch_frames, batch_results, score_threshold, nms_threshold);
+  GST_LOG ("Inferenced batch of %zu frames", batch_frames.size());
+  for (size_t i = 0; i < batch_requests.size(); i++) {
+    OrtDaemonRequest const& request = batch_requests[i];
+    Reply(*request.connection, request.detect.slot, res, batch_results.GetDetections(i));
+  }
+}
+
+/**
+ * @brief Serves clients until Stop is called.
+ * 
+ * @return true if stopped on request.
+ * @return false on a socket error.
+ */
+bool OrtDaemon::Run() {
+  std::vector<struct pollfd> fds;
+  std::vector<OrtDaemonConnection *> polled;
+  while (!stop_requested) {
+    fds.clear();
+    polled.clear();
+    fds.push_back({listen_fd, POLLIN, 0});
+    for (auto& connection : connections) {
+      fds.push_back({connection->fd, POLLIN, 0});
+      polled.push_back(connection.get());
+    }
+
+    // Wake up when the oldest waiting request is due to be batched
+    int64_t timeout_us = IDLE_POLL_TIMEOUT_US;
+    if (!pending.empty()) {
+      timeout_us = std::max<int64_t>(0, pending.front().arrival_us + batch_timeout_us - g_get_monotonic_time ());
+      timeout_us = std::min<int64_t>(timeout_us, IDLE_POLL_TIMEOUT_US);
+    }
+    struct timespec timeout = {(time_t) (timeout_us / G_USEC_PER_SEC), (long) (timeout_us % G_USEC_PER_SEC) * 1000};
+    if (ppoll(fds.data(), fds.size(), &timeout, NULL) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      GST_ERROR ("Unable to poll: %s", g_strerror (errno));
+      return false;
+    }
+
+    for (size_t i = 0; i < polled.size(); i++) {
+      short revents = fds[i + 1].revents;
+      if (revents & POLLIN) {
+        polled[i]->failed |= !Receive(*polled[i]);
+      } else if (revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        polled[i]->failed = true;
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      Accept();
+    }
+
+    // Drop disconnected clients, along with their outstanding requests
+    for (auto it = connections.begin(); it != connections.end();) {
+      OrtDaemonConnection *connection = it->get();
+      if (!connection->failed) {
+        ++it;
+        continue;
+      }
+      pending.erase(std::remove_if(pending.begin(), pending.end(),
+          [connection](OrtDaemonRequest const& request) { return request.connection == connection; }), pending.end());
+      Close(*connection);
+      it = connections.erase(it);
+      GST_INFO ("Client disconnected (%zu clients)", connections.size());
+    }
+
+    int64_t now = g_get_monotonic_time ();
+    while (!pending.empty() && (pending.size() >= max_batch || now - pending.front().arrival_us >= batch_timeout_us)) {
+      RunBatch();
+    }
+  }
+  return true;
+}
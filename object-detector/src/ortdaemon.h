@@ -0,0 +1,93 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __ORT_DAEMON_H__
+#define __ORT_DAEMON_H__
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ortclient.h"
+#include "ortdaemonprotocol.h"
+
+// Client connected to the daemon, with its mapped frame region
+struct OrtDaemonConnection {
+  int fd = -1;
+  bool ready = false;
+  bool failed = false;
+  uint8_t *region = nullptr;
+  size_t region_size = 0;
+  uint32_t num_slots = 0;
+  uint32_t max_detections = 0;
+  uint64_t frame_size = 0;
+};
+
+// DETECT request waiting to be batched
+struct OrtDaemonRequest {
+  OrtDaemonConnection *connection;
+  OrtDaemonDetect detect;
+  int64_t arrival_us;
+};
+
+/**
+ * @brief Local inference server. Owns a single OrtClient (and thus one copy of the
+ * model and its thread pools) and serves detection requests from any number of
+ * client processes over a Unix socket, with frames exchanged in shared memory.
+ * Requests arriving together, from any clients, are inferenced as one batch.
+ */
+class OrtDaemon {
+  private:
+    OrtClient& ort_client;
+    std::string socket_path;
+    int listen_fd;
+    std::list<std::unique_ptr<OrtDaemonConnection>> connections;
+    std::vector<OrtDaemonRequest> pending;
+    size_t max_batch;
+    int64_t batch_timeout_us;
+    std::atomic<bool> stop_requested;
+    // Reused across batches
+    std::vector<DetectionFrame> batch_frames;
+    std::vector<OrtDaemonRequest> batch_requests;
+    DetectionResults batch_results;
+
+    void Accept();
+    bool Receive(OrtDaemonConnection& connection);
+    bool HandleHello(OrtDaemonConnection& connection, OrtDaemonHello const& hello);
+    bool HandleMap(OrtDaemonConnection& connection, OrtDaemonMap const& map, int memfd);
+    bool HandleDetect(OrtDaemonConnection& connection, OrtDaemonDetect const& detect);
+    void Unmap(OrtDaemonConnection& connection);
+    void Close(OrtDaemonConnection& connection);
+    void RunBatch();
+    void Reply(OrtDaemonConnection& connection, uint32_t slot, bool status, std::vector<Detection> const& detections);
+
+  public:
+    OrtDaemon(OrtClient& ort_client);
+    ~OrtDaemon();
+    void SetBatching(size_t max_batch, int64_t batch_timeout_us);
+    bool Listen(std::string const& socket_path);
+    bool Run();
+    void Stop();
+};
+
+#endif
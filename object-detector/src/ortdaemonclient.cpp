@@ -0,0 +1,369 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ortdaemonclient.h"
+
+// Time to wait for the daemon to answer HELLO
+#define HANDSHAKE_TIMEOUT_SEC 5
+
+OrtDaemonClient::OrtDaemonClient(uint32_t num_slots, uint32_t max_detections) : fd(-1), broken(false), region(nullptr), region_size(0),
+    num_slots(std::max<uint32_t>(num_slots, 1)), max_detections(max_detections), frame_size(0),
+    labels(std::make_shared<std::vector<std::string>>()), next_slot(0), in_flight(0), reading(false) {
+  slot_busy.resize(this->num_slots, false);
+  slot_done.resize(this->num_slots, false);
+  slot_reply.resize(this->num_slots);
+}
+
+OrtDaemonClient::~OrtDaemonClient() {
+  Disconnect();
+  if (region) {
+    munmap(region, region_size);
+  }
+}
+
+/**
+ * @brief Connects to daemon.
+ * 
+ * @param socket_path path of daemon's Unix socket.
+ * @return true if connected.
+ * @return false otherwise.
+ */
+bool OrtDaemonClient::Init(std::string const& socket_path) {
+  std::lock_guard<std::mutex> guard(lock);
+  this->socket_path = socket_path;
+  Disconnect();
+  return Connect();
+}
+
+std::shared_ptr<std::vector<std::string> const> OrtDaemonClient::GetClassLabels() {
+  std::lock_guard<std::mutex> guard(lock);
+  return labels;
+}
+
+/**
+ * @brief Connects to daemon and exchanges HELLO/READY. Called with lock held and
+ * no frames in flight.
+ */
+bool OrtDaemonClient::Connect() {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    GST_ERROR ("Daemon socket path '%s' is too long!", socket_path.c_str());
+    return false;
+  }
+  strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (sock < 0 || connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    GST_ERROR ("Unable to connect to daemon at '%s': %s", socket_path.c_str(), g_strerror (errno));
+    if (sock >= 0) {
+      close(sock);
+    }
+    return false;
+  }
+
+  // Bound handshake, replies to frames may then take as long as inference does
+  struct timeval timeout = {HANDSHAKE_TIMEOUT_SEC, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  OrtDaemonHello hello = {ORT_DAEMON_MSG_HELLO, ORT_DAEMON_PROTOCOL_VERSION};
+  std::vector<uint8_t> reply(ORT_DAEMON_MAX_MESSAGE_SIZE);
+  ssize_t size = -1;
+  if (send(sock, &hello, sizeof(hello), MSG_NOSIGNAL) == sizeof(hello)) {
+    size = recv(sock, reply.data(), reply.size(), 0);
+  }
+  OrtDaemonReady ready;
+  if (size < (ssize_t) sizeof(ready)) {
+    GST_ERROR ("Daemon at '%s' did not answer!", socket_path.c_str());
+    close(sock);
+    return false;
+  }
+  memcpy(&ready, reply.data(), sizeof(ready));
+  if (ready.type != ORT_DAEMON_MSG_READY || !ready.status || sizeof(ready) + ready.labels_size > (size_t) size) {
+    GST_ERROR ("Daemon at '%s' refused connection!", socket_path.c_str());
+    close(sock);
+    return false;
+  }
+  timeout = {0, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  auto class_labels = std::make_shared<std::vector<std::string>>();
+  std::string label;
+  for (size_t i = sizeof(ready); i < sizeof(ready) + ready.labels_size; i++) {
+    if (reply[i] == '\n') {
+      class_labels->push_back(label);
+      label.clear();
+    } else {
+      label += (char) reply[i];
+    }
+  }
+  labels = class_labels;
+  fd = sock;
+  broken = false;
+  // A new connection has no region mapped yet
+  frame_size = 0;
+  return true;
+}
+
+/**
+ * @brief Creates a new shared memory region fitting frames of frame_size bytes,
+ * and passes it to the daemon. Called with lock held and no frames in flight.
+ */
+bool OrtDaemonClient::Map(uint64_t frame_size) {
+  size_t size = num_slots * OrtDaemonSlotStride(frame_size, max_detections);
+  int memfd = memfd_create("ortdaemon-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    GST_ERROR ("Unable to create shared memory: %s", g_strerror (errno));
+    return false;
+  }
+  // Seal size, so the daemon may safely map it
+  void *mapping = MAP_FAILED;
+  if (ftruncate(memfd, size) == 0 && fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0) {
+    mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  }
+  if (mapping == MAP_FAILED) {
+    GST_ERROR ("Unable to map shared memory: %s", g_strerror (errno));
+    close(memfd);
+    return false;
+  }
+
+  OrtDaemonMap map = {ORT_DAEMON_MSG_MAP, num_slots, max_detections, frame_size};
+  union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct iovec iov = {&map, sizeof(map)};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+  ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  // Daemon holds its own reference once sent
+  close(memfd);
+  if (sent != sizeof(map)) {
+    GST_ERROR ("Unable to pass shared memory to daemon: %s", g_strerror (errno));
+    munmap(mapping, size);
+    return false;
+  }
+
+  if (region) {
+    munmap(region, region_size);
+  }
+  region = (uint8_t *) mapping;
+  region_size = size;
+  this->frame_size = frame_size;
+  return true;
+}
+
+// Closes connection. Called with lock held and no thread reading replies.
+void OrtDaemonClient::Disconnect() {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  broken = false;
+  frame_size = 0;
+}
+
+// Marks connection broken and fails all frames in flight. Called with lock held.
+void OrtDaemonClient::FailInFlight() {
+  if (!broken && fd >= 0) {
+    // Wakes up any thread blocked reading replies, without releasing the fd under it
+    shutdown(fd, SHUT_RDWR);
+  }
+  broken = true;
+  for (uint32_t i = 0; i < num_slots; i++) {
+    if (slot_busy[i] && !slot_done[i]) {
+      slot_done[i] = true;
+      slot_reply[i].status = 0;
+    }
+  }
+  cond.notify_all();
+}
+
+/**
+ * @brief Reads one reply on behalf of all threads waiting for one, releasing lock
+ * meanwhile. Only one thread reads at a time.
+ */
+bool OrtDaemonClient::ReadReply(std::unique_lock<std::mutex>& guard) {
+  OrtDaemonDone done;
+  int sock = fd;
+  reading = true;
+  guard.unlock();
+  ssize_t size = recv(sock, &done, sizeof(done), 0);
+  int error = errno;
+  guard.lock();
+  reading = false;
+  if (size != sizeof(done) || done.type != ORT_DAEMON_MSG_DONE || done.slot >= num_slots || !slot_busy[done.slot]) {
+    GST_ERROR ("Lost connection to daemon: %s", size < 0 ? g_strerror (error) : "unexpected reply");
+    FailInFlight();
+    return false;
+  }
+  slot_done[done.slot] = true;
+  slot_reply[done.slot] = done;
+  cond.notify_all();
+  return true;
+}
+
+/**
+ * @brief Detects objects in a frame through the daemon. Frame data is not modified.
+ * May be called from several threads concurrently.
+ * 
+ * @param frame frame to process.
+ * @param detections out-param holding the frame's detections on return.
+ * @param score_threshold score threshold when filtering bounding boxes.
+ * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @return true if inference succeeded.
+ * @return false otherwise.
+ */
+bool OrtDaemonClient::Detect(DetectionFrame const& frame, std::vector<Detection>& detections, float score_threshold, float nms_threshold) {
+  detections.clear();
+  uint64_t size = (uint64_t) frame.width * frame.height * 3;
+  std::unique_lock<std::mutex> guard(lock);
+
+  // Connection and region may only be replaced with no frames in flight
+  if (fd < 0 || broken || size > frame_size) {
+    cond.wait(guard, [this] { return in_flight == 0; });
+    if (broken) {
+      Disconnect();
+    }
+    if (fd < 0 && !Connect()) {
+      return false;
+    }
+    if (size > frame_size && !Map(size)) {
+      Disconnect();
+      return false;
+    }
+  }
+
+  // Take the next free slot of the ring
+  cond.wait(guard, [this] { return in_flight < num_slots || broken; });
+  if (broken) {
+    return false;
+  }
+  uint32_t slot = next_slot;
+  while (slot_busy[slot]) {
+    slot = (slot + 1) % num_slots;
+  }
+  next_slot = (slot + 1) % num_slots;
+  slot_busy[slot] = true;
+  slot_done[slot] = false;
+  in_flight++;
+  uint8_t *slot_data = region + slot * OrtDaemonSlotStride(frame_size, max_detections);
+  Detection const *slot_detections = (Detection const *) (slot_data + OrtDaemonDetectionOffset(frame_size));
+  std::shared_ptr<std::vector<std::string> const> class_labels = labels;
+
+  guard.unlock();
+  memcpy(slot_data, frame.data, size);
+  guard.lock();
+
+  OrtDaemonDetect detect = {ORT_DAEMON_MSG_DETECT, slot, frame.width, frame.height, frame.is_rgb ? 1u : 0u, score_threshold, nms_threshold};
+  if (!broken && send(fd, &detect, sizeof(detect), MSG_NOSIGNAL) != sizeof(detect)) {
+    GST_ERROR ("Unable to send frame to daemon: %s", g_strerror (errno));
+    FailInFlight();
+  }
+  while (!slot_done[slot]) {
+    if (reading) {
+      cond.wait(guard);
+    } else {
+      ReadReply(guard);
+    }
+  }
+  OrtDaemonDone reply = slot_reply[slot];
+  guard.unlock();
+
+  if (reply.status) {
+    uint32_t count = std::min(reply.num_detections, max_detections);
+    for (uint32_t i = 0; i < count; i++) {
+      // Class index comes from another process, only keep those we have labels for
+      Detection const& detection = slot_detections[i];
+      if (detection.class_index >= 0 && (size_t) detection.class_index < class_labels->size()) {
+        detections.push_back(detection);
+      }
+    }
+  }
+
+  guard.lock();
+  slot_busy[slot] = false;
+  in_flight--;
+  cond.notify_all();
+  return reply.status != 0;
+}
+
+/**
+ * @brief Runs object detection through the daemon, drawing detections onto input data.
+ * Input data is modified in-place.
+ * 
+ * @param data input image data.
+ * @param vmeta GStreamer video meta for current frame.
+ * @param score_threshold score threshold when filtering bounding boxes.
+ * @param nms_threshold threshold for non-maximal suppression and IOU.
+ * @param timings optional out-param for the time spent in each stage. The round
+ * trip to the daemon is accounted as run time.
+ * @return size_t number of detections drawn.
+ */
+size_t OrtDaemonClient::RunModel(uint8_t *const data, GstVideoMeta *vmeta, float score_threshold, float nms_threshold, DetectionTimings *timings) {
+  // Reused by each thread's calls, so that steady-state detection does not allocate
+  static thread_local std::vector<Detection> detections;
+  DetectionFrame frame{data, (int) vmeta->width, (int) vmeta->height, true};
+  switch (vmeta->format) {
+    case GST_VIDEO_FORMAT_RGB:
+      break;
+    case GST_VIDEO_FORMAT_BGR:
+      frame.is_rgb = false;
+      break;
+    default:
+      GST_ERROR ("Unable to recognize color format!");
+      return 0;
+  }
+  DetectionTimings stage_timings;
+  size_t num_detections = 0;
+  gint64 start = g_get_monotonic_time ();
+  if (Detect(frame, detections, score_threshold, nms_threshold)) {
+    gint64 detected = g_get_monotonic_time ();
+    stage_timings.run_us = detected - start;
+    stage_timings.run_start_us = start;
+    DrawDetections(frame, detections, *GetClassLabels());
+    stage_timings.draw_us = g_get_monotonic_time () - detected;
+    stage_timings.draw_start_us = detected;
+    num_detections = detections.size();
+  }
+  if (timings) {
+    *timings = stage_timings;
+  }
+  return num_detections;
+}
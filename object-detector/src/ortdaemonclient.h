@@ -0,0 +1,79 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __ORT_DAEMON_CLIENT_H__
+#define __ORT_DAEMON_CLIENT_H__
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <gst/video/video.h>
+#include "detection.h"
+#include "ortdaemonprotocol.h"
+
+/**
+ * @brief Thin client of ort-daemon. Frames are copied into a shared memory ring
+ * of slots and inferenced by the daemon, which writes detections back into the
+ * slot. Any number of threads may detect concurrently, up to one frame per slot.
+ * A lost connection is re-established on the next frame.
+ */
+class OrtDaemonClient {
+  private:
+    std::string socket_path;
+    int fd;
+    // Connection failed, to be re-established once no frames are in flight
+    bool broken;
+    uint8_t *region;
+    size_t region_size;
+    uint32_t num_slots;
+    uint32_t max_detections;
+    uint64_t frame_size;
+    // Replaced on reconnect, while earlier frames may still be drawn with the old labels
+    std::shared_ptr<std::vector<std::string> const> labels;
+    // Per-slot state: in use by a frame, answered by daemon, and the answer
+    std::vector<bool> slot_busy;
+    std::vector<bool> slot_done;
+    std::vector<OrtDaemonDone> slot_reply;
+    uint32_t next_slot;
+    uint32_t in_flight;
+    // Set while a thread is reading replies on behalf of all waiting threads
+    bool reading;
+    std::mutex lock;
+    std::condition_variable cond;
+
+    bool Connect();
+    bool Map(uint64_t frame_size);
+    void Disconnect();
+    void FailInFlight();
+    bool ReadReply(std::unique_lock<std::mutex>& guard);
+
+  public:
+    OrtDaemonClient(uint32_t num_slots = 2, uint32_t max_detections = 1024);
+    ~OrtDaemonClient();
+    bool Init(std::string const& socket_path);
+    std::shared_ptr<std::vector<std::string> const> GetClassLabels();
+    bool Detect(DetectionFrame const& frame, std::vector<Detection>& detections, float = 0.25, float = 0.213);
+    size_t RunModel(uint8_t *const data, GstVideoMeta *vmeta, float = 0.25, float = 0.213, DetectionTimings * = nullptr);
+};
+
+#endif
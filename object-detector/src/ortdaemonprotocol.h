@@ -0,0 +1,109 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __ORT_DAEMON_PROTOCOL_H__
+#define __ORT_DAEMON_PROTOCOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "detection.h"
+
+/*
+ * Wire protocol between ort-daemon and its clients.
+ *
+ * Clients connect to the daemon's SOCK_SEQPACKET Unix socket, which only carries
+ * small control messages. Frames and detections are exchanged through a memfd
+ * region created by the client and passed to the daemon with SCM_RIGHTS. The
+ * region is a ring of num_slots slots, each holding one frame (interleaved 8-bit
+ * RGB/BGR) followed by room for max_detections detections.
+ *
+ * HELLO    client -> daemon, answered by READY (with class labels).
+ * MAP      client -> daemon, carries the region's memfd. Sent before the first
+ *          DETECT and whenever frames outgrow the region, with no DETECT in flight.
+ * DETECT   client -> daemon, frame written to a slot. Answered by DONE (naming the
+ *          slot) once the slot's detections are written. Requests may be batched
+ *          with those of other clients, so several may be in flight per client.
+ */
+
+#define ORT_DAEMON_PROTOCOL_VERSION 1
+// Upper bound on a control message, including class labels in READY
+#define ORT_DAEMON_MAX_MESSAGE_SIZE 65536
+// Slots are aligned to cache lines (and detections within them)
+#define ORT_DAEMON_SLOT_ALIGNMENT 64
+
+enum OrtDaemonMessageType : uint32_t {
+  ORT_DAEMON_MSG_HELLO,
+  ORT_DAEMON_MSG_READY,
+  ORT_DAEMON_MSG_MAP,
+  ORT_DAEMON_MSG_DETECT,
+  ORT_DAEMON_MSG_DONE
+};
+
+struct OrtDaemonHello {
+  uint32_t type;
+  uint32_t version;
+};
+
+// Followed by labels_size bytes of class labels, each terminated by '\n'
+struct OrtDaemonReady {
+  uint32_t type;
+  uint32_t status;
+  uint32_t labels_size;
+};
+
+// Accompanied by the region's memfd, sealed against shrinking
+struct OrtDaemonMap {
+  uint32_t type;
+  uint32_t num_slots;
+  uint32_t max_detections;
+  uint64_t frame_size;
+};
+
+struct OrtDaemonDetect {
+  uint32_t type;
+  uint32_t slot;
+  int32_t width;
+  int32_t height;
+  uint32_t is_rgb;
+  float score_threshold;
+  float nms_threshold;
+};
+
+struct OrtDaemonDone {
+  uint32_t type;
+  uint32_t slot;
+  uint32_t status;
+  // Detections written to the slot (at most max_detections)
+  uint32_t num_detections;
+};
+
+// Offset of a slot's detections from the start of the slot
+inline size_t OrtDaemonDetectionOffset(uint64_t frame_size) {
+  return (frame_size + ORT_DAEMON_SLOT_ALIGNMENT - 1) / ORT_DAEMON_SLOT_ALIGNMENT * ORT_DAEMON_SLOT_ALIGNMENT;
+}
+
+// Distance between consecutive slots in the region
+inline size_t OrtDaemonSlotStride(uint64_t frame_size, uint32_t max_detections) {
+  size_t size = OrtDaemonDetectionOffset(frame_size) + max_detections * sizeof(Detection);
+  return (size + ORT_DAEMON_SLOT_ALIGNMENT - 1) / ORT_DAEMON_SLOT_ALIGNMENT * ORT_DAEMON_SLOT_ALIGNMENT;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "ortprofile.h"
+
+// Suffix of the node events timing an operator's kernel (as opposed to its fences)
+#define ORT_KERNEL_TIME_SUFFIX "_kernel_time"
+
+// Stores a string value of an event field
+static void SetStringField(OrtProfileEvent& event, int depth, std::string const& parent, std::string const& key, std::string const& value) {
+  if (depth == 2 && key == "cat") {
+    event.cat = value;
+  } else if (depth == 2 && key == "name") {
+    event.name = value;
+  } else if (depth == 3 && parent == "args" && key == "op_name") {
+    event.op_name = value;
+  } else if (depth == 3 && parent == "args" && key == "provider") {
+    event.provider = value;
+  }
+}
+
+/**
+ * @brief Parses an ORT profile, a JSON array of Chrome trace events. Only the
+ * fields ORT writes that are of interest are extracted; each event's JSON text
+ * is kept so that it can be copied into other traces.
+ *
+ * @param json profile file contents.
+ * @param events out-param holding the profile's events.
+ * @return true if the profile was well-formed.
+ * @return false otherwise.
+ */
+bool ParseOrtProfile(std::string const& json, std::vector<OrtProfileEvent>& events) {
+  size_t start = json.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos || json[start] != '[') {
+    return false;
+  }
+  int depth = 0;
+  bool in_string = false;
+  bool escaped = false;
+  // Whether the next string or number is the value of key (rather than a key)
+  bool expect_value = false;
+  std::string token;
+  std::string key;
+  // Key of the object being parsed within an event, e.g. "args"
+  std::string parent;
+  OrtProfileEvent event;
+  size_t event_start = 0;
+  for (size_t i = start; i < json.size(); i++) {
+    char c = json[i];
+    if (in_string) {
+      if (escaped) {
+        escaped = false;
+      } else if (c == '\\') {
+        escaped = true;
+      } else if (c == '"') {
+        in_string = false;
+        if (expect_value) {
+          SetStringField(event, depth, parent, key, token);
+          expect_value = false;
+        } else {
+          key = token;
+        }
+        continue;
+      }
+      token += c;
+      continue;
+    }
+    switch (c) {
+      case '"':
+        in_string = true;
+        token.clear();
+        break;
+      case '[':
+      case '{':
+        depth++;
+        if (c == '{' && depth == 2) {
+          event = OrtProfileEvent();
+          event_start = i;
+        } else if (depth == 3) {
+          parent = key;
+        }
+        expect_value = false;
+        break;
+      case ']':
+      case '}':
+        depth--;
+        if (c == '}' && depth == 1) {
+          event.json = json.substr(event_start, i - event_start + 1);
+          events.push_back(event);
+        }
+        expect_value = false;
+        break;
+      case ':': {
+        expect_value = true;
+        size_t value_start = json.find_first_not_of(" \t\r\n", i + 1);
+        if (value_start == std::string::npos) {
+          return false;
+        }
+        char first = json[value_start];
+        if (depth == 2 && (first == '-' || (first >= '0' && first <= '9'))) {
+          const char *value = json.c_str() + value_start;
+          char *end;
+          int64_t number = (int64_t) llround(strtod(value, &end));
+          if (key == "ts") {
+            event.ts = number;
+            event.ts_offset = value_start - event_start;
+            event.ts_length = end - value;
+          } else if (key == "dur") {
+            event.dur = number;
+          }
+          i = end - json.c_str() - 1;
+          expect_value = false;
+        }
+        break;
+      }
+      case ',':
+        expect_value = false;
+        break;
+      default:
+        break;
+    }
+  }
+  return depth == 0 && !in_string;
+}
+
+/**
+ * @brief Reads and parses an ORT profile file.
+ *
+ * @param path profile file path.
+ * @param events out-param holding the profile's events.
+ * @return true if the profile was read and well-formed.
+ * @return false otherwise.
+ */
+bool ReadOrtProfile(std::string const& path, std::vector<OrtProfileEvent>& events) {
+  std::ifstream input(path);
+  if (!input.good()) {
+    return false;
+  }
+  std::stringstream contents;
+  contents << input.rdbuf();
+  return ParseOrtProfile(contents.str(), events);
+}
+
+/**
+ * @brief Totals kernel time per operator type and execution provider.
+ *
+ * @param events profile events, possibly from several sessions' profiles.
+ * @param summary out-param holding the per-operator costs.
+ */
+void SummarizeOrtProfile(std::vector<OrtProfileEvent> const& events, OrtProfileSummary& summary) {
+  summary = OrtProfileSummary();
+  std::map<std::pair<std::string, std::string>, OrtOperatorCost> costs;
+  size_t suffix_length = sizeof(ORT_KERNEL_TIME_SUFFIX) - 1;
+  for (OrtProfileEvent const& event : events) {
+    if (event.cat == "Session" && event.name == "model_run") {
+      summary.runs++;
+      summary.run_us += event.dur;
+      continue;
+    }
+    if (event.cat != "Node" || event.op_name.empty() || event.name.size() < suffix_length ||
+        event.name.compare(event.name.size() - suffix_length, suffix_length, ORT_KERNEL_TIME_SUFFIX) != 0) {
+      continue;
+    }
+    OrtOperatorCost& cost = costs[std::make_pair(event.op_name, event.provider)];
+    cost.op_name = event.op_name;
+    cost.provider = event.provider;
+    cost.calls++;
+    cost.total_us += event.dur;
+  }
+  for (auto& entry : costs) {
+    summary.operators.push_back(entry.second);
+  }
+  std::sort(summary.operators.begin(), summary.operators.end(), [](OrtOperatorCost const& a, OrtOperatorCost const& b) {
+    return a.total_us > b.total_us;
+  });
+}
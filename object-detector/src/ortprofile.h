@@ -0,0 +1,69 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __ORT_PROFILE_H__
+#define __ORT_PROFILE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Trace event of an ORT session profile (see OrtClient::SetProfiling)
+struct OrtProfileEvent {
+  // Event JSON object, as written by ORT
+  std::string json;
+  // Location of the ts value within json
+  size_t ts_offset = 0;
+  size_t ts_length = 0;
+  // Microseconds since profiling start
+  int64_t ts = 0;
+  int64_t dur = 0;
+  // "Session" or "Node"
+  std::string cat;
+  std::string name;
+  // Node events only: operator type and execution provider that ran it
+  std::string op_name;
+  std::string provider;
+};
+
+// Time spent in one operator type on one execution provider
+struct OrtOperatorCost {
+  std::string op_name;
+  std::string provider;
+  uint64_t calls = 0;
+  double total_us = 0;
+};
+
+// Summary of an ORT session profile
+struct OrtProfileSummary {
+  // Number of profiled session runs
+  uint64_t runs = 0;
+  // Total time of profiled session runs
+  double run_us = 0;
+  // By descending total time
+  std::vector<OrtOperatorCost> operators;
+};
+
+bool ParseOrtProfile(std::string const& json, std::vector<OrtProfileEvent>& events);
+bool ReadOrtProfile(std::string const& path, std::vector<OrtProfileEvent>& events);
+void SummarizeOrtProfile(std::vector<OrtProfileEvent> const& events, OrtProfileSummary& summary);
+
+#endif
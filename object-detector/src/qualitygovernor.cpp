@@ -0,0 +1,129 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include "qualitygovernor.h"
+
+// Round input size down to a multiple of 32 (largest YOLO stride), with a lower bound.
+static int ScaleInputSize(int size, float scale) {
+  return std::max(160, ((int) (size * scale) / 32) * 32);
+}
+
+/**
+ * @brief Construct a new QualityGovernor object with a single (full quality) level.
+ */
+QualityGovernor::QualityGovernor() {
+  Configure(0, 1, 0, false);
+}
+
+/**
+ * @brief Builds quality ladder and resets controller state.
+ * Levels alternate between skipping more frames, pre-filtering more candidate
+ * boxes by score, and (for dynamic models) shrinking the input size.
+ * 
+ * @param budget_ms target average processing time per frame, in milliseconds.
+ * @param base_interval configured inference interval (full quality).
+ * @param base_input_size configured model input size (full quality).
+ * @param dynamic_input whether the model allows changing input size.
+ */
+void QualityGovernor::Configure(double budget_ms, int base_interval, int base_input_size, bool dynamic_input) {
+  this->budget_ms = budget_ms;
+  levels.clear();
+  levels.push_back(QualityLevel(base_interval, 0.0f, base_input_size));
+  levels.push_back(QualityLevel(base_interval + 1, 0.0f, base_input_size));
+  levels.push_back(QualityLevel(base_interval + 1, 0.1f, base_input_size));
+  int reduced_size = base_input_size;
+  if (dynamic_input && base_input_size > 0) {
+    reduced_size = ScaleInputSize(base_input_size, 0.75f);
+    levels.push_back(QualityLevel(base_interval + 1, 0.1f, reduced_size));
+  }
+  levels.push_back(QualityLevel(base_interval + 2, 0.1f, reduced_size));
+  levels.push_back(QualityLevel(base_interval + 2, 0.2f, reduced_size));
+  if (dynamic_input && base_input_size > 0) {
+    reduced_size = ScaleInputSize(base_input_size, 0.5f);
+    levels.push_back(QualityLevel(base_interval + 2, 0.2f, reduced_size));
+  }
+  levels.push_back(QualityLevel(base_interval + 3, 0.2f, reduced_size));
+  level = 0;
+  ResetHistory();
+}
+
+// Forget latency history, e.g. after changing level (measurements no longer apply).
+void QualityGovernor::ResetHistory() {
+  smoothed_latency_ms = -1;
+  over_budget_count = 0;
+  under_budget_count = 0;
+}
+
+/**
+ * @brief Feeds a measured inference latency into the controller.
+ * Cost per frame is the inference latency amortized over the inference interval.
+ * 
+ * @param latency_ms latency of the latest inference, in milliseconds.
+ * @return true if the quality level changed.
+ * @return false otherwise.
+ */
+bool QualityGovernor::Update(double latency_ms) {
+  if (budget_ms <= 0) {
+    return false;
+  }
+  if (smoothed_latency_ms < 0) {
+    smoothed_latency_ms = latency_ms;
+  } else {
+    smoothed_latency_ms = LATENCY_SMOOTHING * latency_ms + (1.0 - LATENCY_SMOOTHING) * smoothed_latency_ms;
+  }
+  double frame_cost_ms = smoothed_latency_ms / levels[level].inference_interval;
+  if (frame_cost_ms > budget_ms) {
+    over_budget_count++;
+    under_budget_count = 0;
+  } else if (frame_cost_ms < budget_ms * RESTORE_HEADROOM) {
+    under_budget_count++;
+    over_budget_count = 0;
+  } else {
+    over_budget_count = 0;
+    under_budget_count = 0;
+  }
+  if (over_budget_count >= DEGRADE_SAMPLES && level + 1 < levels.size()) {
+    level++;
+    ResetHistory();
+    return true;
+  }
+  if (under_budget_count >= RESTORE_SAMPLES && level > 0) {
+    level--;
+    ResetHistory();
+    return true;
+  }
+  return false;
+}
+
+QualityLevel const& QualityGovernor::GetLevel() {
+  return levels[level];
+}
+
+// Current level, where 0 is full quality.
+size_t QualityGovernor::GetLevelIndex() {
+  return level;
+}
+
+// Smoothed inference latency in milliseconds, or -1 if there is no recent measurement.
+double QualityGovernor::GetSmoothedLatency() {
+  return smoothed_latency_ms;
+}
@@ -0,0 +1,70 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __QUALITY_GOVERNOR_H__
+#define __QUALITY_GOVERNOR_H__
+
+#include <vector>
+
+// Inference quality settings applied by the governor
+struct QualityLevel {
+  int inference_interval;
+  float score_threshold_boost;
+  int input_size;
+
+  QualityLevel(int inference_interval, float score_threshold_boost, int input_size) : inference_interval(inference_interval), score_threshold_boost(score_threshold_boost), input_size(input_size) {}
+};
+
+/**
+ * @brief Load-adaptive quality controller. Watches measured inference latency
+ * against a per-frame budget and steps through a ladder of quality levels:
+ * degrading when over budget, restoring when headroom returns.
+ */
+class QualityGovernor {
+  private:
+    // Smoothing factor for latency moving average
+    const double LATENCY_SMOOTHING = 0.2;
+    // Consecutive samples required before changing level
+    const int DEGRADE_SAMPLES = 5;
+    const int RESTORE_SAMPLES = 30;
+    // Fraction of budget that must be free before restoring quality
+    const double RESTORE_HEADROOM = 0.6;
+
+    std::vector<QualityLevel> levels;
+    size_t level;
+    double budget_ms;
+    double smoothed_latency_ms;
+    int over_budget_count;
+    int under_budget_count;
+
+    void ResetHistory();
+
+  public:
+    QualityGovernor();
+    ~QualityGovernor() = default;
+    void Configure(double budget_ms, int base_interval, int base_input_size, bool dynamic_input);
+    bool Update(double latency_ms);
+    QualityLevel const& GetLevel();
+    size_t GetLevelIndex();
+    double GetSmoothedLatency();
+};
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "stagestats.h"
+
+/**
+ * @brief Construct a new StageStats object.
+ * 
+ * @param window number of most recent frames statistics are computed over.
+ */
+StageStats::StageStats(size_t window) : window(std::max<size_t>(window, 1)) {
+  for (auto& stage_samples : samples) {
+    stage_samples.resize(this->window);
+  }
+  sorted.reserve(this->window);
+  Reset();
+}
+
+// Clears timings and counters
+void StageStats::Reset() {
+  std::lock_guard<std::mutex> guard(lock);
+  next_sample = 0;
+  num_samples = 0;
+  frames = 0;
+  detections = 0;
+  skipped = 0;
+}
+
+/**
+ * @brief Records an inferenced frame.
+ * 
+ * @param timings time spent in each stage.
+ * @param total_us time spent inferencing the frame overall.
+ * @param num_detections number of objects detected in the frame.
+ */
+void StageStats::AddFrame(DetectionTimings const& timings, double total_us, size_t num_detections) {
+  std::lock_guard<std::mutex> guard(lock);
+  samples[INFERENCE_STAGE_PREPROCESS][next_sample] = timings.preprocess_us;
+  samples[INFERENCE_STAGE_RUN][next_sample] = timings.run_us;
+  samples[INFERENCE_STAGE_POSTPROCESS][next_sample] = timings.postprocess_us;
+  samples[INFERENCE_STAGE_DRAW][next_sample] = timings.draw_us;
+  samples[INFERENCE_STAGE_TOTAL][next_sample] = total_us;
+  next_sample = (next_sample + 1) % window;
+  num_samples = std::min(num_samples + 1, window);
+  frames++;
+  detections += num_detections;
+}
+
+// Records a frame passed on without inference
+void StageStats::AddSkipped() {
+  std::lock_guard<std::mutex> guard(lock);
+  frames++;
+  skipped++;
+}
+
+// Number of frames seen, inferenced or skipped
+uint64_t StageStats::GetFrames() {
+  std::lock_guard<std::mutex> guard(lock);
+  return frames;
+}
+
+uint64_t StageStats::GetDetections() {
+  std::lock_guard<std::mutex> guard(lock);
+  return detections;
+}
+
+uint64_t StageStats::GetSkipped() {
+  std::lock_guard<std::mutex> guard(lock);
+  return skipped;
+}
+
+/**
+ * @brief Computes mean and nearest-rank percentiles of a stage's recent timings.
+ * 
+ * @param stage stage to summarize.
+ * @return StageSummary summary in milliseconds (all zero before any frame).
+ */
+StageSummary StageStats::GetSummary(InferenceStage stage) {
+  std::lock_guard<std::mutex> guard(lock);
+  StageSummary summary = {0, 0, 0, 0};
+  if (num_samples == 0) {
+    return summary;
+  }
+  sorted.assign(samples[stage].begin(), samples[stage].begin() + num_samples);
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0;
+  for (double sample : sorted) {
+    sum += sample;
+  }
+  auto percentile = [this](double p) {
+    size_t rank = (size_t) std::ceil(p * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1] / 1000.0;
+  };
+  summary.mean_ms = sum / sorted.size() / 1000.0;
+  summary.p50_ms = percentile(0.50);
+  summary.p95_ms = percentile(0.95);
+  summary.p99_ms = percentile(0.99);
+  return summary;
+}
+
+// Name of a stage, as used in property and message field names
+const char *StageStats::GetStageName(InferenceStage stage) {
+  switch (stage) {
+    case INFERENCE_STAGE_PREPROCESS:
+      return "preprocess";
+    case INFERENCE_STAGE_RUN:
+      return "run";
+    case INFERENCE_STAGE_POSTPROCESS:
+      return "postprocess";
+    case INFERENCE_STAGE_DRAW:
+      return "draw";
+    default:
+      return "total";
+  }
+}
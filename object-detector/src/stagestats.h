@@ -0,0 +1,80 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __STAGE_STATS_H__
+#define __STAGE_STATS_H__
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "detection.h"
+
+// Stages of inferencing a frame, timed separately
+enum InferenceStage {
+  INFERENCE_STAGE_PREPROCESS,
+  INFERENCE_STAGE_RUN,
+  INFERENCE_STAGE_POSTPROCESS,
+  INFERENCE_STAGE_DRAW,
+  // Whole inference call, including time not attributed to a stage
+  INFERENCE_STAGE_TOTAL,
+  INFERENCE_STAGE_COUNT
+};
+
+// Summary of a stage's recent timings, in milliseconds
+struct StageSummary {
+  double mean_ms;
+  double p50_ms;
+  double p95_ms;
+  double p99_ms;
+};
+
+/**
+ * @brief Rolling per-stage timing statistics and frame counters. Keeps the
+ * timings of the most recent frames, from which means and percentiles are
+ * computed on demand, so recording a frame is cheap. Thread-safe.
+ */
+class StageStats {
+  private:
+    std::mutex lock;
+    size_t window;
+    // Ring buffer of the last `window` timings of each stage, in microseconds
+    std::vector<double> samples[INFERENCE_STAGE_COUNT];
+    size_t next_sample;
+    size_t num_samples;
+    uint64_t frames;
+    uint64_t detections;
+    uint64_t skipped;
+    std::vector<double> sorted;
+
+  public:
+    StageStats(size_t window = 512);
+    ~StageStats() = default;
+    void Reset();
+    void AddFrame(DetectionTimings const& timings, double total_us, size_t num_detections);
+    void AddSkipped();
+    uint64_t GetFrames();
+    uint64_t GetDetections();
+    uint64_t GetSkipped();
+    StageSummary GetSummary(InferenceStage stage);
+    static const char *GetStageName(InferenceStage stage);
+};
+
+#endif
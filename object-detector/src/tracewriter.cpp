@@ -0,0 +1,269 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "tracewriter.h"
+
+// Interval at which the flush thread drains thread buffers
+#define TRACE_FLUSH_INTERVAL_MS 100
+
+static std::atomic<uint64_t> next_writer_id{1};
+
+// Buffer of the writer the current thread last recorded to
+struct TraceThreadCache {
+  uint64_t writer_id = 0;
+  TraceThreadBuffer *buffer = nullptr;
+};
+static thread_local TraceThreadCache thread_cache;
+
+// Escapes a string for use within a JSON string literal
+static std::string EscapeJson(std::string const& str) {
+  std::string escaped;
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      default:
+        if ((unsigned char) c < 0x20) {
+          char code[8];
+          snprintf(code, sizeof(code), "\\u%04x", c);
+          escaped += code;
+        } else {
+          escaped += c;
+        }
+        break;
+    }
+  }
+  return escaped;
+}
+
+/**
+ * @brief Construct a new TraceWriter object.
+ *
+ * @param capacity number of spans each thread's buffer holds.
+ */
+TraceWriter::TraceWriter(size_t capacity) : id(next_writer_id++), capacity(std::max<size_t>(capacity, 1)), file(nullptr), pid(getpid()), first_event(true), named_buffers(0), stopping(false) {
+}
+
+TraceWriter::~TraceWriter() {
+  Close();
+}
+
+/**
+ * @brief Creates the trace file and starts the flush thread.
+ *
+ * @param path trace file path.
+ * @param process_name name of the process track in trace viewers.
+ * @param category category of recorded spans, e.g. the element name.
+ * @return true if the trace file was created.
+ * @return false otherwise.
+ */
+bool TraceWriter::Open(std::string const& path, std::string const& process_name, std::string const& category) {
+  std::lock_guard<std::mutex> guard(file_lock);
+  if (file) {
+    return false;
+  }
+  file = fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  this->category = EscapeJson(category);
+  first_event = true;
+  named_buffers = 0;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+  WriteEvent("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"args\":{\"name\":\"" + EscapeJson(process_name) + "\"}}");
+  stopping = false;
+  flush_thread = std::thread(&TraceWriter::FlushLoop, this);
+  return true;
+}
+
+// Appends an event to the trace file. Caller must hold file_lock.
+void TraceWriter::WriteEvent(std::string const& event) {
+  fputs(first_event ? "\n" : ",\n", file);
+  fputs(event.c_str(), file);
+  first_event = false;
+}
+
+// Buffer the calling thread records to, created on the thread's first span
+TraceThreadBuffer *TraceWriter::GetThreadBuffer() {
+  if (thread_cache.writer_id == id) {
+    return thread_cache.buffer;
+  }
+  int tid = (int) syscall(SYS_gettid);
+  TraceThreadBuffer *buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(buffers_lock);
+    // A thread alternating between writers keeps its buffer
+    for (auto& existing : buffers) {
+      if (existing->tid == tid) {
+        buffer = existing.get();
+        break;
+      }
+    }
+    if (!buffer) {
+      char name[16] = "";
+      pthread_getname_np(pthread_self(), name, sizeof(name));
+      buffers.emplace_back(new TraceThreadBuffer());
+      buffer = buffers.back().get();
+      buffer->tid = tid;
+      buffer->thread_name = name;
+      buffer->spans.resize(capacity);
+    }
+  }
+  thread_cache.writer_id = id;
+  thread_cache.buffer = buffer;
+  return buffer;
+}
+
+/**
+ * @brief Records a span on the calling thread's track. Lock-free once the
+ * thread has recorded its first span.
+ *
+ * @param name span name; must be a static string.
+ * @param pts frame presentation timestamp, or TRACE_SPAN_NO_PTS.
+ * @param start_us span start, in monotonic clock microseconds.
+ * @param dur_us span duration, in microseconds.
+ */
+void TraceWriter::Record(const char *name, uint64_t pts, int64_t start_us, int64_t dur_us) {
+  TraceThreadBuffer *buffer = GetThreadBuffer();
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  if (head - buffer->tail.load(std::memory_order_acquire) >= capacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->spans[head % capacity] = TraceSpan{name, pts, start_us, dur_us};
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+// Drains all thread buffers to the trace file. Caller must hold file_lock.
+void TraceWriter::FlushBuffers() {
+  std::vector<TraceThreadBuffer*> snapshot;
+  {
+    std::lock_guard<std::mutex> guard(buffers_lock);
+    for (auto& buffer : buffers) {
+      snapshot.push_back(buffer.get());
+    }
+  }
+  for (; named_buffers < snapshot.size(); named_buffers++) {
+    TraceThreadBuffer *buffer = snapshot[named_buffers];
+    WriteEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(buffer->tid) + ",\"args\":{\"name\":\"" + EscapeJson(buffer->thread_name) + "\"}}");
+  }
+  char event[512];
+  for (TraceThreadBuffer *buffer : snapshot) {
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+    for (; tail < head; tail++) {
+      TraceSpan const& span = buffer->spans[tail % capacity];
+      int len = snprintf(event, sizeof(event), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRId64 ",\"dur\":%" PRId64 ",\"pid\":%d,\"tid\":%d",
+          span.name, category.c_str(), span.start_us, span.dur_us, pid, buffer->tid);
+      if (span.pts != TRACE_SPAN_NO_PTS && len > 0 && (size_t) len < sizeof(event)) {
+        snprintf(event + len, sizeof(event) - len, ",\"args\":{\"pts\":%" PRIu64 "}}", span.pts);
+      } else if (len > 0 && (size_t) len < sizeof(event)) {
+        snprintf(event + len, sizeof(event) - len, "}");
+      }
+      WriteEvent(event);
+    }
+    buffer->tail.store(head, std::memory_order_release);
+  }
+  fflush(file);
+}
+
+// Flush thread body
+void TraceWriter::FlushLoop() {
+  std::unique_lock<std::mutex> flush_guard(flush_lock);
+  while (!stopping) {
+    flush_cond.wait_for(flush_guard, std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+    std::lock_guard<std::mutex> guard(file_lock);
+    FlushBuffers();
+  }
+}
+
+/**
+ * @brief Appends the events of an ORT session profile (see
+ * OrtClient::SetProfiling) to the trace, so that operator timings appear on
+ * the same timeline as recorded spans.
+ *
+ * @param events events of the profile.
+ * @param offset_us offset from ORT profile timestamps to monotonic clock microseconds.
+ * @return true if the events were merged.
+ * @return false if the writer is not open.
+ */
+bool TraceWriter::MergeOrtProfile(std::vector<OrtProfileEvent> const& events, int64_t offset_us) {
+  std::lock_guard<std::mutex> guard(file_lock);
+  if (!file) {
+    return false;
+  }
+  for (OrtProfileEvent const& event : events) {
+    std::string json = event.json;
+    if (event.ts_length > 0) {
+      json.replace(event.ts_offset, event.ts_length, std::to_string(event.ts + offset_us));
+    }
+    WriteEvent(json);
+  }
+  return true;
+}
+
+// Number of spans dropped because a thread buffer was full
+uint64_t TraceWriter::GetDropped() {
+  std::lock_guard<std::mutex> guard(buffers_lock);
+  uint64_t dropped = 0;
+  for (auto& buffer : buffers) {
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
+
+/**
+ * @brief Stops the flush thread, writes remaining spans and completes the
+ * trace file. Spans recorded afterwards are discarded.
+ *
+ * @return true if the trace file was written successfully.
+ * @return false otherwise, or if the writer was not open.
+ */
+bool TraceWriter::Close() {
+  if (flush_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> flush_guard(flush_lock);
+      stopping = true;
+    }
+    flush_cond.notify_one();
+    flush_thread.join();
+  }
+  std::lock_guard<std::mutex> guard(file_lock);
+  if (!file) {
+    return false;
+  }
+  FlushBuffers();
+  fputs("\n]}\n", file);
+  bool res = !ferror(file);
+  res = fclose(file) == 0 && res;
+  file = nullptr;
+  return res;
+}
@@ -0,0 +1,101 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __TRACE_WRITER_H__
+#define __TRACE_WRITER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ortprofile.h"
+
+// Frame without a timestamp
+#define TRACE_SPAN_NO_PTS UINT64_MAX
+
+// Timed span of work on a frame, in monotonic clock microseconds
+struct TraceSpan {
+  // Static string, e.g. a stage name
+  const char *name;
+  uint64_t pts;
+  int64_t start_us;
+  int64_t dur_us;
+};
+
+// Ring buffer of spans recorded by one thread. Single producer (the recording
+// thread), single consumer (the flush thread), so neither side takes a lock.
+struct TraceThreadBuffer {
+  int tid;
+  std::string thread_name;
+  std::vector<TraceSpan> spans;
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+  std::atomic<uint64_t> dropped{0};
+};
+
+/**
+ * @brief Writes spans to a Chrome trace event (JSON) file, which can be opened
+ * in Perfetto or chrome://tracing. Each recording thread gets a ring buffer of
+ * its own, which a background thread drains to the file periodically, so
+ * recording never blocks on I/O or on other threads. Spans are dropped (and
+ * counted) if a thread records faster than its buffer is drained.
+ */
+class TraceWriter {
+  private:
+    // Distinguishes writers for the per-thread buffer cache
+    uint64_t id;
+    size_t capacity;
+    FILE *file;
+    int pid;
+    bool first_event;
+    std::string category;
+    std::vector<std::unique_ptr<TraceThreadBuffer>> buffers;
+    std::mutex buffers_lock;
+    // Number of buffers whose thread name has been written
+    size_t named_buffers;
+    // Serializes file writes (flush thread, merges and Close)
+    std::mutex file_lock;
+    std::thread flush_thread;
+    std::mutex flush_lock;
+    std::condition_variable flush_cond;
+    bool stopping;
+
+    TraceThreadBuffer *GetThreadBuffer();
+    void WriteEvent(std::string const& event);
+    void FlushBuffers();
+    void FlushLoop();
+
+  public:
+    TraceWriter(size_t capacity = 16384);
+    ~TraceWriter();
+    bool Open(std::string const& path, std::string const& process_name, std::string const& category);
+    void Record(const char *name, uint64_t pts, int64_t start_us, int64_t dur_us);
+    bool MergeOrtProfile(std::vector<OrtProfileEvent> const& events, int64_t offset_us);
+    uint64_t GetDropped();
+    bool Close();
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "yolodecoder.h"
+
+// Anchors per grid cell of the specialized decoders (YOLOv3/v4)
+#define YOLO_SPECIALIZED_ANCHORS 3
+// Class count of COCO-trained models
+#define YOLO_COCO_CLASSES 80
+// Custom models with up to this many classes get a specialized decoder
+#define YOLO_MAX_SMALL_CLASSES 10
+
+// Decoders specialized for 1 to N classes, tried from N down
+template <int N, YOLOFeatureLayout Layout>
+struct YOLOSmallClassDecoders {
+  static YOLODecoderBase *Create(int num_classes) {
+    if (num_classes == N) {
+      return new YOLODecoder<N, YOLO_SPECIALIZED_ANCHORS, Layout>(num_classes, YOLO_SPECIALIZED_ANCHORS);
+    }
+    return YOLOSmallClassDecoders<N - 1, Layout>::Create(num_classes);
+  }
+};
+
+template <YOLOFeatureLayout Layout>
+struct YOLOSmallClassDecoders<0, Layout> {
+  static YOLODecoderBase *Create(int) {
+    return nullptr;
+  }
+};
+
+template <YOLOFeatureLayout Layout>
+static YOLODecoderBase *CreateForLayout(int num_classes, int anchors_per_cell) {
+  YOLODecoderBase *decoder = nullptr;
+  if (anchors_per_cell == YOLO_SPECIALIZED_ANCHORS) {
+    if (num_classes == YOLO_COCO_CLASSES) {
+      decoder = new YOLODecoder<YOLO_COCO_CLASSES, YOLO_SPECIALIZED_ANCHORS, Layout>(num_classes, anchors_per_cell);
+    } else {
+      decoder = YOLOSmallClassDecoders<YOLO_MAX_SMALL_CLASSES, Layout>::Create(num_classes);
+    }
+  }
+  if (!decoder) {
+    decoder = new YOLODecoder<0, 0, Layout>(num_classes, anchors_per_cell);
+  }
+  return decoder;
+}
+
+/**
+ * @brief Creates the decoder for a model's output. 80-class (COCO) and 1 to 10
+ * class models with 3 anchors per cell get a decoder with these constants
+ * compiled in; any other model gets the generic decoder.
+ *
+ * @param num_classes number of classes of the model.
+ * @param anchors_per_cell anchors per grid cell of each output layer.
+ * @param layout order of output layer values.
+ * @return std::unique_ptr<YOLODecoderBase> decoder.
+ */
+std::unique_ptr<YOLODecoderBase> CreateYOLODecoder(int num_classes, int anchors_per_cell, YOLOFeatureLayout layout) {
+  if (layout == YOLOFeatureLayout::CHANNEL_MAJOR) {
+    return std::unique_ptr<YOLODecoderBase>(CreateForLayout<YOLOFeatureLayout::CHANNEL_MAJOR>(num_classes, anchors_per_cell));
+  }
+  return std::unique_ptr<YOLODecoderBase>(CreateForLayout<YOLOFeatureLayout::CELL_MAJOR>(num_classes, anchors_per_cell));
+}
@@ -0,0 +1,196 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __YOLO_DECODER_H__
+#define __YOLO_DECODER_H__
+
+#include <cmath>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Representation of bounding box
+struct BoundingBox {
+  float xmin;
+  float ymin;
+  float xmax;
+  float ymax;
+  float score;
+  int class_index;
+  int tile_index;
+
+  BoundingBox(float xmin, float ymin, float xmax, float ymax, float score, int class_index, int tile_index = 0) : xmin(xmin), ymin(ymin), xmax(xmax), ymax(ymax), score(score), class_index(class_index), tile_index(tile_index) {}
+};
+
+// Region of the original image fed to the model as one batch entry
+struct ImageTile {
+  cv::Rect roi;
+  float resize_ratio;
+  float dw;
+  float dh;
+};
+
+// Order of an output layer's values
+enum class YOLOFeatureLayout {
+  // {batch, grid height, grid width, anchors, features}: features of an anchor are contiguous
+  CELL_MAJOR,
+  // {batch, anchors * features, grid height, grid width}: each feature is a grid-sized plane
+  CHANNEL_MAJOR
+};
+
+// Geometry of one output layer
+struct YOLOLayerParams {
+  int64_t grid_height;
+  int64_t grid_width;
+  float stride;
+  float xyscale;
+  // (width, height) of each anchor of the layer
+  float const *anchors;
+};
+
+/**
+ * @brief Decodes anchor-based YOLO output layers into bounding boxes. Each
+ * anchor's features are {x, y, w, h, objectness, class probabilities...}.
+ * Implementations are specialized by CreateYOLODecoder for the model's class
+ * count, anchors per cell and feature layout.
+ */
+class YOLODecoderBase {
+  public:
+    virtual ~YOLODecoderBase() = default;
+    virtual int GetNumClasses() = 0;
+    /**
+     * @brief Appends boxes of one tile's output layer scoring at least
+     * threshold to class_boxes (by class index), in original image coordinates.
+     */
+    virtual void DecodeLayer(float const *output, YOLOLayerParams const& layer, ImageTile const& tile, int tile_index, float threshold, std::vector<std::list<std::unique_ptr<BoundingBox>>>& class_boxes) = 0;
+    virtual void DecodeLayer(cv::float16_t const *output, YOLOLayerParams const& layer, ImageTile const& tile, int tile_index, float threshold, std::vector<std::list<std::unique_ptr<BoundingBox>>>& class_boxes) = 0;
+};
+
+// Apply sigmoid function to a value; returns a number between 0 and 1
+static inline float YOLOSigmoid(float value) {
+  return 1.0f / (1.0f + std::exp(-value));
+}
+
+/**
+ * @brief YOLO decoder with compile-time model constants. A NumClasses or
+ * AnchorsPerCell of 0 is taken from the constructor arguments instead, which
+ * serves as the fallback for any other model. With constant class counts and
+ * strides, the class loop is unrolled and all offsets are computed
+ * incrementally, outside the per-anchor loop.
+ */
+template <int NumClasses, int AnchorsPerCell, YOLOFeatureLayout Layout>
+class YOLODecoder : public YOLODecoderBase {
+  private:
+    int num_classes;
+    int anchors_per_cell;
+
+    int Classes() const {
+      return NumClasses > 0 ? NumClasses : num_classes;
+    }
+
+    int Anchors() const {
+      return AnchorsPerCell > 0 ? AnchorsPerCell : anchors_per_cell;
+    }
+
+    // Class with the highest probability, and that probability
+    template <typename T>
+    static inline std::pair<int, float> FindMaxClass(T const *probs, long stride, int classes) {
+      int max_class = 0;
+      float max_prob = (float) probs[0];
+      for (int i = 1; i < classes; i++) {
+        float prob = (float) probs[i * stride];
+        if (prob > max_prob) {
+          max_class = i;
+          max_prob = prob;
+        }
+      }
+      return std::pair<int, float>(max_class, max_prob);
+    }
+
+    template <typename T>
+    void Decode(T const *output, YOLOLayerParams const& layer, ImageTile const& tile, int tile_index, float threshold, std::vector<std::list<std::unique_ptr<BoundingBox>>>& class_boxes) {
+      const int classes = Classes();
+      const int anchors = Anchors();
+      const long cells = layer.grid_height * layer.grid_width;
+      const long features = 5 + classes;
+      // Distance between consecutive features, anchors and grid cells
+      const long feature_stride = Layout == YOLOFeatureLayout::CELL_MAJOR ? 1 : cells;
+      const long anchor_stride = Layout == YOLOFeatureLayout::CELL_MAJOR ? features : features * cells;
+      const long cell_stride = Layout == YOLOFeatureLayout::CELL_MAJOR ? anchors * features : 1;
+      const float xyscale = layer.xyscale;
+      const float xyshift = 0.5f * (layer.xyscale - 1.0f);
+      const float stride = layer.stride;
+      T const *cell = output;
+      for (int64_t row = 0; row < layer.grid_height; row++) {
+        for (int64_t col = 0; col < layer.grid_width; col++, cell += cell_stride) {
+          T const *box = cell;
+          for (int anchor = 0; anchor < anchors; anchor++, box += anchor_stride) {
+            float conf = (float) box[4 * feature_stride];
+            if (conf < threshold) {
+              continue;
+            }
+            // Class and score first: they reject more boxes than the coordinate checks, and cost no exp()
+            std::pair<int, float> max_class_prob = FindMaxClass(box + 5 * feature_stride, feature_stride, classes);
+            float score = conf * max_class_prob.second;
+            if (score < threshold) {
+              continue;
+            }
+            // Transform coordinates
+            float x = ((YOLOSigmoid((float) box[0]) * xyscale) - xyshift + col) * stride;
+            float y = ((YOLOSigmoid((float) box[feature_stride]) * xyscale) - xyshift + row) * stride;
+            float w = std::exp((float) box[2 * feature_stride]) * layer.anchors[anchor * 2];
+            float h = std::exp((float) box[3 * feature_stride]) * layer.anchors[anchor * 2 + 1];
+            // Convert (x, y, w, h) => (xmin, ymin, xmax, ymax), relative to original image
+            float xmin = (x - w * 0.5f - tile.dw) / tile.resize_ratio + tile.roi.x;
+            float ymin = (y - h * 0.5f - tile.dh) / tile.resize_ratio + tile.roi.y;
+            float xmax = (x + w * 0.5f - tile.dw) / tile.resize_ratio + tile.roi.x;
+            float ymax = (y + h * 0.5f - tile.dh) / tile.resize_ratio + tile.roi.y;
+            // Disregard clipped boxes, and boxes with invalid size/area
+            if (xmin > xmax || ymin > ymax || (xmax - xmin) * (ymax - ymin) <= 0) {
+              continue;
+            }
+            class_boxes[max_class_prob.first].push_back(std::make_unique<BoundingBox>(xmin, ymin, xmax, ymax, score, max_class_prob.first, tile_index));
+          }
+        }
+      }
+    }
+
+  public:
+    YOLODecoder(int num_classes, int anchors_per_cell) : num_classes(num_classes), anchors_per_cell(anchors_per_cell) {}
+
+    int GetNumClasses() {
+      return Classes();
+    }
+
+    void DecodeLayer(float const *output, YOLOLayerParams const& layer, ImageTile const& tile, int tile_index, float threshold, std::vector<std::list<std::unique_ptr<BoundingBox>>>& class_boxes) {
+      Decode(output, layer, tile, tile_index, threshold, class_boxes);
+    }
+
+    void DecodeLayer(cv::float16_t const *output, YOLOLayerParams const& layer, ImageTile const& tile, int tile_index, float threshold, std::vector<std::list<std::unique_ptr<BoundingBox>>>& class_boxes) {
+      Decode(output, layer, tile, tile_index, threshold, class_boxes);
+    }
+};
+
+std::unique_ptr<YOLODecoderBase> CreateYOLODecoder(int num_classes, int anchors_per_cell, YOLOFeatureLayout layout);
+
+#endif
@@ -25,12 +25,17 @@
  * @brief Construct a new YOLOv4 object.
  */
 YOLOv4::YOLOv4() {
-  LoadClassColors();
-  class_boxes = std::vector<std::list<std::unique_ptr<BoundingBox>>>(NUM_CLASSES);
   anchors = std::vector<float>{12.f,16.f, 19.f,36.f, 40.f,28.f, 36.f,75.f, 76.f,55.f, 72.f,146.f, 142.f,110.f, 192.f,243.f, 459.f,401.f};
   strides = std::vector<float>{8.f, 16.f, 32.f};
   xyscale = std::vector<float>{1.2, 1.1, 1.05};
-  padded_image = cv::Mat(INPUT_HEIGHT, INPUT_WIDTH, CV_8UC3, cv::Scalar(128, 128, 128));
+  tile_rows = 1;
+  tile_cols = 1;
+  tile_overlap = 0.0f;
+  input_width = DEFAULT_INPUT_SIZE;
+  input_height = DEFAULT_INPUT_SIZE;
+  num_classes = DEFAULT_NUM_CLASSES;
+  output_layout = YOLOFeatureLayout::CELL_MAJOR;
+  decoder = CreateYOLODecoder(num_classes, ANCHORS_PER_CELL, output_layout);
 }
 
 // Need to implement virutal destructor for ObjectDetectionModel interface.
@@ -38,218 +43,415 @@ YOLOv4::YOLOv4() {
 ObjectDetectionModel::~ObjectDetectionModel() { }
 
 size_t YOLOv4::GetNumClasses() {
-  return NUM_CLASSES;
+  return num_classes;
 }
 
+// Size of a single image within the input tensor
 size_t YOLOv4::GetInputTensorSize() {
-  return INPUT_HEIGHT * INPUT_WIDTH * INPUT_CHANNELS;
+  return input_height * input_width * INPUT_CHANNELS;
+}
+
+int YOLOv4::GetInputWidth() {
+  return input_width;
+}
+
+int YOLOv4::GetInputHeight() {
+  return input_height;
+}
+
+// YOLOv4 takes NHWC input
+bool YOLOv4::IsChannelsLast() {
+  return true;
+}
+
+/**
+ * @brief Sets model input dimensions. Preprocessing canvas and expected
+ * output grid sizes follow from these dimensions. Must not be called while
+ * frames are being processed.
+ * 
+ * @param width input width.
+ * @param height input height.
+ * @return true if dimensions are valid for YOLOv4.
+ * @return false if dimensions are not a positive multiple of the largest stride.
+ */
+bool YOLOv4::SetInputSize(int width, int height) {
+  if (width <= 0 || height <= 0 || width % INPUT_SIZE_ALIGNMENT != 0 || height % INPUT_SIZE_ALIGNMENT != 0) {
+    GST_ERROR ("Invalid YOLOv4 input size %dx%d, dimensions must be a multiple of %d!", width, height, INPUT_SIZE_ALIGNMENT);
+    return false;
+  }
+  input_width = width;
+  input_height = height;
+  return true;
+}
+
+/**
+ * @brief Derives the class count and layout of output layers from the model's
+ * output shapes, and selects the matching decoder. Layers are either
+ * {batch, grid height, grid width, anchors, 5 + classes} or
+ * {batch, anchors * (5 + classes), grid height, grid width}. Dynamic feature
+ * axes leave the default of 80 classes. Must not be called while frames are
+ * being processed.
+ * 
+ * @param output_dims shape of each output layer.
+ * @return true if the shapes are valid YOLOv4 outputs.
+ * @return false otherwise.
+ */
+bool YOLOv4::SetOutputShapes(std::vector<std::vector<int64_t>> const& output_dims) {
+  if (output_dims.size() != strides.size()) {
+    GST_ERROR ("Expected %zu YOLOv4 output layers, got %zu!", strides.size(), output_dims.size());
+    return false;
+  }
+  int classes = -1;
+  YOLOFeatureLayout layout = YOLOFeatureLayout::CELL_MAJOR;
+  for (size_t layer = 0; layer < output_dims.size(); layer++) {
+    std::vector<int64_t> const& dims = output_dims[layer];
+    YOLOFeatureLayout layer_layout;
+    int64_t features;
+    if (dims.size() == 5 && (dims[3] == -1 || dims[3] == ANCHORS_PER_CELL)) {
+      layer_layout = YOLOFeatureLayout::CELL_MAJOR;
+      features = dims[4];
+    } else if (dims.size() == 4 && (dims[1] == -1 || dims[1] % ANCHORS_PER_CELL == 0)) {
+      layer_layout = YOLOFeatureLayout::CHANNEL_MAJOR;
+      features = dims[1] == -1 ? -1 : dims[1] / ANCHORS_PER_CELL;
+    } else {
+      GST_ERROR ("Unexpected shape of YOLOv4 output layer %zu!", layer);
+      return false;
+    }
+    if (layer > 0 && layer_layout != layout) {
+      GST_ERROR ("YOLOv4 output layers have different layouts!");
+      return false;
+    }
+    layout = layer_layout;
+    if (features == -1) {
+      continue;
+    }
+    if (features <= 5 || (classes != -1 && features - 5 != classes)) {
+      GST_ERROR ("Unexpected number of features %" G_GINT64_FORMAT " in YOLOv4 output layer %zu!", features, layer);
+      return false;
+    }
+    classes = (int) (features - 5);
+  }
+  num_classes = classes > 0 ? classes : DEFAULT_NUM_CLASSES;
+  output_layout = layout;
+  decoder = CreateYOLODecoder(num_classes, ANCHORS_PER_CELL, output_layout);
+  return true;
+}
+
+// Number of images (tiles) per input tensor
+size_t YOLOv4::GetBatchSize() {
+  return tile_rows * tile_cols;
+}
+
+/**
+ * @brief Configures tiled inference. The original image is split into a grid
+ * of overlapping tiles, each of which is processed as one entry of a batched input.
+ * 
+ * @param rows number of tile rows.
+ * @param cols number of tile columns.
+ * @param overlap fraction of a tile's width/height shared with its neighbours.
+ */
+void YOLOv4::SetTiling(int rows, int cols, float overlap) {
+  tile_rows = std::max(rows, 1);
+  tile_cols = std::max(cols, 1);
+  tile_overlap = std::min(std::max(overlap, 0.0f), 0.9f);
+}
+
+/**
+ * @return std::unique_ptr<ModelContext> new, empty YOLOv4 context.
+ */
+std::unique_ptr<ModelContext> YOLOv4::CreateContext() {
+  std::unique_ptr<YOLOv4Context> ctx(new YOLOv4Context());
+  ctx->class_boxes = std::vector<std::list<std::unique_ptr<BoundingBox>>>(num_classes);
+  return std::unique_ptr<ModelContext>(std::move(ctx));
+}
+
+/**
+ * @brief Computes tile regions for the context's original image dimensions.
+ * Tiles are evenly distributed such that neighbouring tiles overlap by `tile_overlap`
+ * and the outermost tiles align with the image borders.
+ * 
+ * @param ctx context to store tiles in.
+ */
+void YOLOv4::ComputeTiles(YOLOv4Context& ctx) {
+  ctx.tiles.clear();
+  int tile_w = std::min(ctx.org_image_w, (int) std::ceil(ctx.org_image_w / (tile_cols - (tile_cols - 1) * tile_overlap)));
+  int tile_h = std::min(ctx.org_image_h, (int) std::ceil(ctx.org_image_h / (tile_rows - (tile_rows - 1) * tile_overlap)));
+  for (int row = 0; row < tile_rows; row++) {
+    for (int col = 0; col < tile_cols; col++) {
+      int x = tile_cols > 1 ? (col * (ctx.org_image_w - tile_w)) / (tile_cols - 1) : 0;
+      int y = tile_rows > 1 ? (row * (ctx.org_image_h - tile_h)) / (tile_rows - 1) : 0;
+      ImageTile tile;
+      tile.roi = cv::Rect(x, y, tile_w, tile_h);
+      ctx.tiles.push_back(tile);
+    }
+  }
 }
 
 /**
  * @brief Pads image to YOLOv4 input specifications.
  * Preserves aspect ratio. Pad with grey (128, 128, 128) pixels.
- * Stores padded iamge internally in a cache (cv::Mat).
  * 
- * @param image image to pad.
+ * @param image image (or tile of an image) to pad.
+ * @param tile out-param to store resize ratio and padding used for this image.
+ * @param canvas out-param to store padded image, of model input dimensions.
  */
-void YOLOv4::PadImage(cv::Mat const& image) {
-  resize_ratio = std::min(INPUT_WIDTH / (org_image_w * 1.0f), INPUT_HEIGHT / (org_image_h * 1.0f));
+void YOLOv4::PadImage(cv::Mat const& image, ImageTile& tile, cv::Mat& canvas) {
+  float resize_ratio = std::min(input_width / (image.cols * 1.0f), input_height / (image.rows * 1.0f));
   // New dimensions to preserve aspect ratio
-  int nw = resize_ratio * org_image_w;
-  int nh = resize_ratio * org_image_h;
+  int nw = resize_ratio * image.cols;
+  int nh = resize_ratio * image.rows;
   // Padding on either side
-  dw = (INPUT_WIDTH - nw) / 2.0f;
-  dh = (INPUT_HEIGHT - nh) / 2.0f;
-  // Reset padded image (padded_image acts as a cache)
-  padded_image = cv::Scalar(128, 128, 128);
+  float dw = (input_width - nw) / 2.0f;
+  float dh = (input_height - nh) / 2.0f;
+  tile.resize_ratio = resize_ratio;
+  tile.dw = dw;
+  tile.dh = dh;
+  // Reset canvas (may act as a cache)
+  canvas = cv::Scalar(128, 128, 128);
   // Resize original image into padded image
-  cv::resize(image, padded_image(cv::Rect(dw, dh, std::floor(nw), std::floor(nh))), cv::Size(std::floor(nw), std::floor(nh)));
+  cv::resize(image, canvas(cv::Rect(dw, dh, std::floor(nw), std::floor(nh))), cv::Size(std::floor(nw), std::floor(nh)));
 }
 
 /**
- * @brief Preprocesses input data to comply with specifications of YOLOv4 algorithm.
+ * @brief Wraps original image data in context for pre/post-processing, and
+ * recomputes the context's tiles if image dimensions changed.
  * 
- * @param data data to process.
- * @param input_tensor_values out-param to store preprocessed tensor values. Has sufficient size for input tensor.
+ * @param ctx context to store image in.
+ * @param data image data.
  * @param width image width.
  * @param height image height.
  * @param is_rgb is image RGB or BGR format.
  */
-void YOLOv4::Preprocess(uint8_t *const data, std::vector<float>& input_tensor_values, int width, int height, bool is_rgb) {
-  org_image_h = height;
-  org_image_w = width;
-  this->is_rgb = is_rgb;
+void YOLOv4::SetOriginalImage(YOLOv4Context& ctx, uint8_t *const data, int width, int height, bool is_rgb) {
+  if (ctx.tiles.size() != GetBatchSize() || width != ctx.org_image_w || height != ctx.org_image_h) {
+    ctx.org_image_h = height;
+    ctx.org_image_w = width;
+    ComputeTiles(ctx);
+  }
+  ctx.is_rgb = is_rgb;
   
-  std::vector<int> image_size{org_image_h, org_image_w};
+  std::vector<int> image_size{ctx.org_image_h, ctx.org_image_w};
   // Wrap opencv mat image
   // NOTE: this does not copy data, simply wraps
-  org_image = cv::Mat(image_size, CV_8UC3, data);
-  // Pad image 
-  PadImage(org_image);
-  // Change from BGR to RGB ordering if needed
-  if (!is_rgb) {
-    cv::cvtColor(padded_image, padded_image, cv::COLOR_BGR2RGB);
-  }
-  // Assign mat values to tensor data vector out-param and scale (COPIES DATA)
-  for (size_t i = 0; i < GetInputTensorSize(); i++) {
-    input_tensor_values[i] = (float) padded_image.data[i] / 255.f;
+  ctx.org_image = cv::Mat(image_size, CV_8UC3, data);
+}
+
+// Context's padding canvas, (re)allocated to the current input dimensions (acts as a cache)
+cv::Mat& YOLOv4::GetCanvas(YOLOv4Context& ctx) {
+  if (ctx.padded_image.rows != input_height || ctx.padded_image.cols != input_width) {
+    ctx.padded_image = cv::Mat(input_height, input_width, CV_8UC3, cv::Scalar(128, 128, 128));
   }
+  return ctx.padded_image;
 }
 
-// Apply sigmoid function to a value; returns a number between 0 and 1
-float sigmoid(float value) {
-  float k = (float) exp(-1.0f * value);
-  return 1.0f / (1.0f + k);
+/**
+ * @brief Pads a tile of the original image into canvas, in RGB ordering.
+ * 
+ * @param ctx context holding the original image.
+ * @param tile tile to process.
+ * @param canvas out-param to store tile image data, of model input dimensions.
+ */
+void YOLOv4::PreprocessTile(YOLOv4Context& ctx, ImageTile& tile, cv::Mat& canvas) {
+  // Pad image (tile view does not copy data)
+  PadImage(ctx.org_image(tile.roi), tile, canvas);
+  // Change from BGR to RGB ordering if needed
+  if (!ctx.is_rgb) {
+    cv::cvtColor(canvas, canvas, cv::COLOR_BGR2RGB);
+  }
 }
 
 /**
- * @brief Transforms YOLOv4 output coordinates into xmin, ymin, xmax, ymax 
- * coordinates relative to original input image. Transforms coordinates
- * in place into `coords` parameter.
+ * @brief Preprocesses input data to comply with specifications of YOLOv4 algorithm.
+ * When tiling is enabled, each tile is written as a separate batch entry.
  * 
- * @param coords raw YOLOv4 output coordinates of bounding box {x, y, w, h}. 
- * @param layer current layer.
- * @param row row of grid cell.
- * @param col column of grid cell.
- * @param anchor anchor index in grid cell.
- * @return true if transformed coordinates are valid.
- * @return false if transformed coordinates are invalid.
+ * @param context YOLOv4 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's first batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
  */
-bool YOLOv4::TransformCoordinates(std::vector<float>& coords, int layer, int row, int col, int anchor) {
-  float x = coords[0];
-  float y = coords[1];
-  float w = coords[2];
-  float h = coords[3];
-  // Transform coordinates
-  x = ((sigmoid(x) * xyscale[layer]) - 0.5f * (xyscale[layer] - 1.0f) + col) * strides[layer];
-  y = ((sigmoid(y) * xyscale[layer]) - 0.5f * (xyscale[layer] - 1.0f) + row) * strides[layer];
-  h = exp(h) * anchors[(layer * 6) + (anchor * 2) + 1]; 
-  w = exp(w) * anchors[(layer * 6) + (anchor * 2)];   
-  // Convert (x, y, w, h) => (xmin, ymin, xmax, ymax)
-  float xmin = x - w * 0.5f;
-  float ymin = y - h * 0.5f;
-  float xmax = x + w * 0.5f;
-  float ymax = y + h * 0.5f;
-  // Convert (xmin, ymin, xmax, ymax) => (xmin_org, ymin_org, xmax_org, ymax_org), relative to original image
-  float xmin_org = 1.0f * (xmin - dw) / resize_ratio;
-  float ymin_org = 1.0f * (ymin - dh) / resize_ratio;
-  float xmax_org = 1.0f * (xmax - dw) / resize_ratio;
-  float ymax_org = 1.0f * (ymax - dh) / resize_ratio;
-  // Disregard clipped boxes
-  if (xmin_org > xmax_org || ymin_org > ymax_org) {
-    return false;
+void YOLOv4::Preprocess(ModelContext& context, uint8_t *const data, float *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv4Context& ctx = static_cast<YOLOv4Context&>(context);
+  SetOriginalImage(ctx, data, width, height, is_rgb);
+  cv::Mat& padded_image = GetCanvas(ctx);
+  size_t tensor_size = GetInputTensorSize();
+  for (size_t t = 0; t < ctx.tiles.size(); t++) {
+    // Pad into cached image
+    PreprocessTile(ctx, ctx.tiles[t], padded_image);
+    // Convert and scale into tensor data vector out-param (COPIES DATA, vectorized by OpenCV)
+    cv::Mat tile_values(input_height, input_width, CV_32FC3, input_tensor_values + t * tensor_size);
+    padded_image.convertTo(tile_values, CV_32FC3, 1.0 / 255.0);
   }
-  // Disregard boxes with invalid size/area
-  auto area = (xmax_org - xmin_org) * (ymax_org - ymin_org);
-  if (area <= 0) {
-    return false;
+}
+
+/**
+ * @brief Preprocesses input data for models taking float16 input.
+ * 
+ * @param context YOLOv4 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's first batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ */
+void YOLOv4::Preprocess(ModelContext& context, uint8_t *const data, Ort::Float16_t *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv4Context& ctx = static_cast<YOLOv4Context&>(context);
+  SetOriginalImage(ctx, data, width, height, is_rgb);
+  cv::Mat& padded_image = GetCanvas(ctx);
+  size_t tensor_size = GetInputTensorSize();
+  for (size_t t = 0; t < ctx.tiles.size(); t++) {
+    PreprocessTile(ctx, ctx.tiles[t], padded_image);
+    // Convert and scale directly to half precision (vectorized by OpenCV)
+    cv::Mat tile_values(input_height, input_width, CV_16FC3, input_tensor_values + t * tensor_size);
+    padded_image.convertTo(tile_values, CV_16FC3, 1.0 / 255.0);
   }
-  // Update vector
-  coords[0] = xmin_org;
-  coords[1] = ymin_org;
-  coords[2] = xmax_org;
-  coords[3] = ymax_org;
-  return true;
 }
 
 /**
- * @brief Finds class index with highest probabilty for a given bounding box.
- * Returns index corresponding to max probability along with the max probability.
+ * @brief Preprocesses input data for models taking uint8 input (e.g. INT8 quantized models).
+ * Tiles are padded directly into the input tensor, skipping float conversion and scaling.
  * 
- * @param layer_output current layer of model output.
- * @param offset offset to beginning of bounding box data.
- * @return std::pair<int, float> (index, probability).
+ * @param context YOLOv4 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's first batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
  */
-std::pair<int, float> YOLOv4::FindMaxClass(float const *layer_output, long offset) {
-  int max_class = -1;
-  float max_prob;
-  for (int i = 0; i < NUM_CLASSES; i++) {
-    if (max_class == -1 || layer_output[offset + 5 + i] > max_prob) {
-      max_class = i;
-      max_prob = layer_output[offset + 5 + i];
-    }
+void YOLOv4::Preprocess(ModelContext& context, uint8_t *const data, uint8_t *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv4Context& ctx = static_cast<YOLOv4Context&>(context);
+  SetOriginalImage(ctx, data, width, height, is_rgb);
+  size_t tensor_size = GetInputTensorSize();
+  for (size_t t = 0; t < ctx.tiles.size(); t++) {
+    // Wrap tensor memory for current tile (NHWC layout matches cv::Mat), no copy
+    cv::Mat canvas(input_height, input_width, CV_8UC3, input_tensor_values + t * tensor_size);
+    PreprocessTile(ctx, ctx.tiles[t], canvas);
   }
-  return std::pair<int, float>(max_class, max_prob);
 }
 
 /**
  * @brief Parses model output to extract bounding boxes. Filters bounding boxes and converts coordinates
  * to be respective to original image. Stores filtered bounding boxes internally.
+ * Output layers may be float or float16; float16 values are read directly without
+ * converting the whole tensor.
  * 
+ * @param ctx YOLOv4 context for this frame.
  * @param model_output YOLOv4 inferencing output.
+ * @param batch_index index of this frame's first tile in the output batch.
  * @param threshold threshold to filter boxes based on confidence/score.
  */
-void YOLOv4::GetBoundingBoxes(std::vector<Ort::Value> const& model_output, float threshold) {
+void YOLOv4::GetBoundingBoxes(YOLOv4Context& ctx, std::vector<Ort::Value> const& model_output, size_t batch_index, float threshold) {
+  // Contexts may outlive a change of class count
+  if (ctx.class_boxes.size() != (size_t) num_classes) {
+    ctx.class_boxes.resize(num_classes);
+  }
   // Iterate through output layers
   for (size_t layer = 0; layer < model_output.size(); layer++) {
-    // Layer data
-    float const *layer_output = model_output[layer].GetTensorData<float>();
-    auto layer_shape = model_output[layer].GetTensorTypeAndShapeInfo().GetShape();
-    auto grid_size = layer_shape[1];
-    auto anchors_per_cell = layer_shape[3];
-    auto features_per_anchor = layer_shape[4];
-    // Iterate through grid cells in current layer, and anchors in each grid cell
-    for (auto row = 0; row < grid_size; row++) {
-      for (auto col = 0; col < grid_size; col++) {
-        for (auto anchor = 0; anchor < anchors_per_cell; anchor++) {
-          // Calculate offset for current grid cell and anchor
-          long offset = (row * grid_size * anchors_per_cell * features_per_anchor) + (col * anchors_per_cell * features_per_anchor) + (anchor * features_per_anchor);
-          // Extract data
-          float x = layer_output[offset + 0];
-          float y = layer_output[offset + 1];
-          float w = layer_output[offset + 2];
-          float h = layer_output[offset + 3]; 
-          float conf = layer_output[offset + 4];
-          if (conf < threshold) {
-            continue;
-          }
-          // Convert coordinates
-          std::vector<float> coords{x, y, w, h};
-          if (!TransformCoordinates(coords, layer, row, col, anchor)) {
-            continue;
-          }
-          // Find class with highest probability
-          std::pair<int, float> max_class_prob = FindMaxClass(layer_output, offset);
-          // Calculate score and compare against threshold
-          float score = conf * max_class_prob.second;
-          if (score < threshold) {
-            continue;
-          }
-          // Create bounding box and add to vector
-          auto bbox = std::make_unique<BoundingBox>(BoundingBox(coords[0], coords[1], coords[2], coords[3], score, max_class_prob.first));
-          class_boxes[max_class_prob.first].push_back(move(bbox));
-        }
-      }
+    auto type_info = model_output[layer].GetTensorTypeAndShapeInfo();
+    auto layer_shape = type_info.GetShape();
+    switch (type_info.GetElementType()) {
+      case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        GetLayerBoundingBoxes(ctx, model_output[layer].GetTensorData<float>(), layer_shape, batch_index, layer, threshold);
+        break;
+      case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+        // Ort::Float16_t and cv::float16_t share the IEEE half-precision layout
+        GetLayerBoundingBoxes(ctx, reinterpret_cast<cv::float16_t const*>(model_output[layer].GetTensorData<Ort::Float16_t>()), layer_shape, batch_index, layer, threshold);
+        break;
+      default:
+        GST_ERROR ("Unsupported output element type %d for layer %zu!", type_info.GetElementType(), layer);
+        break;
     }
   }
 }
 
 /**
- * @brief Calculate the intersection over union (IOU) of two bounding boxes.
+ * @brief Extracts bounding boxes from a single output layer. Each batch entry of
+ * the output corresponds to one tile of the original image.
  * 
- * @param bbox1 first bounding box.
- * @param bbox2 second bounding box.
- * @return float IOU of the two boxes.
+ * @param ctx YOLOv4 context for this frame.
+ * @param layer_output output layer data.
+ * @param layer_shape output layer shape (see SetOutputShapes).
+ * @param batch_index index of this frame's first tile in the output batch.
+ * @param layer index of output layer.
+ * @param threshold threshold to filter boxes based on confidence/score.
  */
-float YOLOv4::BboxIOU(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2) {
-  float area1 = (bbox1->xmax - bbox1->xmin) * (bbox1->ymax - bbox1->ymin);
-  float area2 = (bbox2->xmax - bbox2->xmin) * (bbox2->ymax - bbox2->ymin);
+template <typename T>
+void YOLOv4::GetLayerBoundingBoxes(YOLOv4Context& ctx, T const *layer_output, std::vector<int64_t> const& layer_shape, size_t batch_index, size_t layer, float threshold) {
+  bool cell_major = output_layout == YOLOFeatureLayout::CELL_MAJOR;
+  if (layer_shape.size() != (cell_major ? 5u : 4u)) {
+    GST_ERROR ("Unexpected rank %zu of output layer %zu!", layer_shape.size(), layer);
+    return;
+  }
+  if ((size_t) layer_shape[0] < batch_index + ctx.tiles.size()) {
+    GST_ERROR ("Output batch of %" G_GINT64_FORMAT " is missing tiles of frame at batch index %zu!", layer_shape[0], batch_index);
+    return;
+  }
+  auto batch_size = ctx.tiles.size();
+  int64_t grid_height = cell_major ? layer_shape[1] : layer_shape[2];
+  int64_t grid_width = cell_major ? layer_shape[2] : layer_shape[3];
+  int64_t layer_features = cell_major ? layer_shape[3] * layer_shape[4] : layer_shape[1];
+  // Grid dimensions must match the configured input size
+  if (grid_height * strides[layer] != input_height || grid_width * strides[layer] != input_width) {
+    GST_ERROR ("Unexpected grid size %" G_GINT64_FORMAT "x%" G_GINT64_FORMAT " for layer %zu with input size %dx%d!", grid_width, grid_height, layer, input_width, input_height);
+    return;
+  }
+  // Features must match the decoder's class count
+  if (layer_features != ANCHORS_PER_CELL * (5 + num_classes)) {
+    GST_ERROR ("Unexpected %" G_GINT64_FORMAT " features per grid cell for layer %zu with %d classes!", layer_features, layer, num_classes);
+    return;
+  }
+  YOLOLayerParams params{grid_height, grid_width, strides[layer], xyscale[layer], anchors.data() + layer * ANCHORS_PER_CELL * 2};
+  long batch_stride = grid_height * grid_width * layer_features;
+  // Iterate through tiles in batch
+  for (size_t t = 0; t < batch_size; t++) {
+    decoder->DecodeLayer(layer_output + (batch_index + t) * batch_stride, params, ctx.tiles[t], t, threshold, ctx.class_boxes);
+  }
+}
+
+// Calculate the area of the intersection of two bounding boxes.
+float BboxIntersection(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2) {
   // Coords of intersection box
   float left = std::max(bbox1->xmin, bbox2->xmin);
   float right = std::min(bbox1->xmax, bbox2->xmax);
   float top = std::max(bbox1->ymin, bbox2->ymin);
   float bottom = std::min(bbox1->ymax, bbox2->ymax);
 
-  float intersection_area;
   if (left > right || top > bottom) {
-    intersection_area = 0;
-  } else {
-    intersection_area = (right - left) * (bottom - top);
+    return 0;
   }
+  return (right - left) * (bottom - top);
+}
+
+/**
+ * @brief Calculate the intersection over union (IOU) of two bounding boxes.
+ * 
+ * @param bbox1 first bounding box.
+ * @param bbox2 second bounding box.
+ * @return float IOU of the two boxes.
+ */
+float YOLOv4::BboxIOU(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2) {
+  float area1 = (bbox1->xmax - bbox1->xmin) * (bbox1->ymax - bbox1->ymin);
+  float area2 = (bbox2->xmax - bbox2->xmin) * (bbox2->ymax - bbox2->ymin);
+  float intersection_area = BboxIntersection(bbox1, bbox2);
   float union_area = area1 + area2 - intersection_area;
   return intersection_area / union_area;
 }
 
+/**
+ * @brief Calculate the intersection over the smaller box's area (IOS) of two bounding boxes.
+ * Used to detect partial boxes of the same object cut at a tile seam, which have a low IOU.
+ * 
+ * @param bbox1 first bounding box.
+ * @param bbox2 second bounding box.
+ * @return float IOS of the two boxes.
+ */
+float YOLOv4::BboxIOS(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2) {
+  float area1 = (bbox1->xmax - bbox1->xmin) * (bbox1->ymax - bbox1->ymin);
+  float area2 = (bbox2->xmax - bbox2->xmin) * (bbox2->ymax - bbox2->ymin);
+  return BboxIntersection(bbox1, bbox2) / std::min(area1, area2);
+}
+
 // Compares score of two bounding boxes. Used to sort vectors of bounding boxes.
 bool CompareBoxScore(std::unique_ptr<BoundingBox>& b1, std::unique_ptr<BoundingBox>& b2) {
   return b2->score < b1->score;
@@ -258,17 +460,21 @@ bool CompareBoxScore(std::unique_ptr<BoundingBox>& b1, std::unique_ptr<BoundingB
 /**
  * @brief Perform non-maximal suppression (nms) on found/filtered bounding boxes.
  * NOTE: this version computes nms per class.
+ * NOTE: boxes from different tiles are also merged when one mostly contains the other,
+ * which removes duplicate/partial detections at tile seams.
  * NOTE: std::list is used instead of std::vector for O(1) removal while iterating.
  * Using std::vector requires a sacrifice in either space or time complexity 
  * for this algorithm.
  * 
- * Stores filtered bounding boxes internally.
+ * Stores filtered bounding boxes in the context.
  * 
+ * @param ctx YOLOv4 context for this frame.
  * @param threshold IOU threshold for nms.
  */
-void YOLOv4::Nms(float threshold) {
-  for (auto i = 0; i < NUM_CLASSES; i++) {
-    std::list<std::unique_ptr<BoundingBox>>& boxes = class_boxes[i];
+void YOLOv4::Nms(YOLOv4Context& ctx, float threshold) {
+  std::vector<std::unique_ptr<BoundingBox>>& filtered_boxes = ctx.filtered_boxes;
+  for (size_t i = 0; i < ctx.class_boxes.size(); i++) {
+    std::list<std::unique_ptr<BoundingBox>>& boxes = ctx.class_boxes[i];
     if (boxes.empty()) {
       continue;
     }
@@ -280,7 +486,15 @@ void YOLOv4::Nms(float threshold) {
       std::list<std::unique_ptr<BoundingBox>>::iterator itr = boxes.begin();
       while (itr != boxes.end()) {
         std::unique_ptr<BoundingBox>& test_box = *itr;
-        if (BboxIOU(accepted_box, test_box) > threshold) {
+        if (accepted_box->tile_index != test_box->tile_index && BboxIOS(accepted_box, test_box) > TILE_MERGE_THRESHOLD) {
+          // Cross-tile duplicate: grow accepted box to cover both parts of the object
+          accepted_box->xmin = std::min(accepted_box->xmin, test_box->xmin);
+          accepted_box->ymin = std::min(accepted_box->ymin, test_box->ymin);
+          accepted_box->xmax = std::max(accepted_box->xmax, test_box->xmax);
+          accepted_box->ymax = std::max(accepted_box->ymax, test_box->ymax);
+          test_box.reset();
+          itr = boxes.erase(itr);
+        } else if (BboxIOU(accepted_box, test_box) > threshold) {
           // Performance: free memory early when possible
           test_box.reset();
           itr = boxes.erase(itr);
@@ -289,91 +503,38 @@ void YOLOv4::Nms(float threshold) {
         }
       }
     }
-    class_boxes[i].clear();
-  }
-}
-
-// Create unique, constant color for each class id.
-void YOLOv4::LoadClassColors() {
-  // Convert HSV to RGB
-  // Saturation and Value will always be 1
-  // Hue depends on class index
-  class_colors = std::vector<cv::Scalar>(NUM_CLASSES);
-  for (int i = 0; i < NUM_CLASSES; i++) {
-    float h = ((1.0f * i) / NUM_CLASSES) * 360;
-    float x = 1.0f - std::abs(std::fmod(h / 60, 2) - 1);
-    float r, g, b;
-    if (h >= 0 && h < 60) {
-      r = 255, g = x * 255, b = 0;
-    } else if (h >= 60 && h < 120) {
-      r = x * 255, g = 255, b = 0;
-    } else if (h >= 120 && h < 180) {
-      r = 0, g = 255, b = x * 255;
-    } else if (h >= 180 && h < 240) {
-      r = 0, g = x * 255, b = 255;
-    } else if (h >= 240 && h < 300) {
-      r = x * 255, g = 0, b = 255;
-    } else {
-      r = 255, g = 0, b = x * 255;
-    }
-    class_colors[i] = cv::Scalar(r, g, b);
+    boxes.clear();
   }
 }
 
 /**
- * @brief Write filtered bounding boxes and class labels/scores to original image.
+ * @brief Moves filtered bounding boxes of the context into detections.
  * 
- * @param class_names vector of class names.
+ * @param ctx YOLOv4 context for this frame.
+ * @param detections out-param to append detections to.
  */
-void YOLOv4::WriteBoundingBoxes(std::vector<std::string> const& class_names) {
-  float font_scale = 0.5f;
-  int bbox_thick = (int) (0.6f * (org_image_h + org_image_w) / 600.f);
-
-  for (size_t i = 0; i < filtered_boxes.size(); i++) {
-    // Bounding box information
-    std::unique_ptr<BoundingBox>& bbox = filtered_boxes[i];
-    std::string const& class_name = class_names[bbox->class_index];
-    float score = bbox->score;
-    auto c1 = cv::Point(bbox->xmin, bbox->ymin);
-    auto c2 = cv::Point(bbox->xmax, bbox->ymax);
-
-    cv::Scalar color = class_colors[bbox->class_index];
-    // Shift color for consistency if image is BGR
-    if (!is_rgb) {
-      auto temp = color[0];
-      color[0] = color[2];
-      color[2] = temp;
-    }
-    // Place rectangle around bounding box
-    cv::Rect rect = cv::Rect(c1, c2);
-    cv::rectangle(org_image, rect, color, bbox_thick);
-
-    std::stringstream msg;
-    msg << class_name << ": " << roundf(score * 100) / 100;
-    int base_line = 0;
-    auto t_size = cv::getTextSize(msg.str(), 0, font_scale, bbox_thick / 2, &base_line);
-    // Place rectangle for class label & score message
-    cv::rectangle(org_image, c1, cv::Point(c1.x + t_size.width, c1.y - t_size.height - 3), color, -1);
-    // Place message
-    cv::putText(org_image, msg.str(), cv::Point(bbox->xmin, bbox->ymin - 2), cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(0, 0, 0), bbox_thick / 2);
-    // Performance: free memory early
-    // bbox.reset();
+void YOLOv4::WriteDetections(YOLOv4Context& ctx, std::vector<Detection>& detections) {
+  for (std::unique_ptr<BoundingBox> const& bbox : ctx.filtered_boxes) {
+    detections.push_back(Detection{bbox->xmin, bbox->ymin, bbox->xmax, bbox->ymax, bbox->score, bbox->class_index});
   }
-  filtered_boxes.clear();
+  ctx.filtered_boxes.clear();
 }
 
 /**
  * @brief Postprocess ORT model output with YOLOv4 bounding box information.
- * Write filtered bounding boxes to original image data using internally
- * stored reference set from Preprocess method.
+ * Filtered bounding boxes are returned as detections in original image
+ * coordinates, using the tiles stored in the context by Preprocess.
  * 
+ * @param context YOLOv4 context passed to Preprocess for this frame.
  * @param model_output ORT output.
- * @param class_labels YOLOv4 class labels.
+ * @param batch_index index of this frame's first tile in the output batch.
  * @param score_threshold threshold for bounding box scores.
  * @param nms_threshold threshold for computing non-maximal suppression.
+ * @param detections out-param to append detections to.
  */
-void YOLOv4::Postprocess(std::vector<Ort::Value> const& model_output, std::vector<std::string> const& class_labels, float score_threshold, float nms_threshold) {
-  GetBoundingBoxes(model_output, score_threshold);
-  Nms(nms_threshold);
-  WriteBoundingBoxes(class_labels);
+void YOLOv4::Postprocess(ModelContext& context, std::vector<Ort::Value> const& model_output, size_t batch_index, float score_threshold, float nms_threshold, std::vector<Detection>& detections) {
+  YOLOv4Context& ctx = static_cast<YOLOv4Context&>(context);
+  GetBoundingBoxes(ctx, model_output, batch_index, score_threshold);
+  Nms(ctx, nms_threshold);
+  WriteDetections(ctx, detections);
 }
@@ -24,67 +24,95 @@
 
 #include <opencv2/opencv.hpp>
 #include "objectdetectionmodel.h"
+#include "yolodecoder.h"
 
-// Representation of bounding box
-struct BoundingBox {
-  float xmin;
-  float ymin;
-  float xmax;
-  float ymax;
-  float score;
-  int class_index;
+// Per-frame YOLOv4 state (see ModelContext)
+struct YOLOv4Context : public ModelContext {
+  // Original image information
+  int org_image_w = 0;
+  int org_image_h = 0;
+  cv::Mat org_image;
+  cv::Mat padded_image;
+  bool is_rgb = true;
 
-  BoundingBox(float xmin, float ymin, float xmax, float ymax, float score, int class_index) : xmin(xmin), ymin(ymin), xmax(xmax), ymax(ymax), score(score), class_index(class_index) {}
+  // Tiles of the original image (a single tile covers the whole image)
+  std::vector<ImageTile> tiles;
+
+  // NOTE: std::list is used here over std::vector for random index deletion
+  // See YOLOv4::Nms function
+  std::vector<std::list<std::unique_ptr<BoundingBox>>> class_boxes;
+  std::vector<std::unique_ptr<BoundingBox>> filtered_boxes;
 };
 
 /**
  * @brief YOLOv4 object detection model. Performs pre/post-processing steps.
+ * Per-frame state lives in a YOLOv4Context, so one instance may serve several
+ * threads as long as its configuration is not changed meanwhile.
  */
 class YOLOv4 : public ObjectDetectionModel {
   private:
     // Model information
-    const int NUM_CLASSES = 80;
-    const int INPUT_HEIGHT = 416;
-    const int INPUT_WIDTH = 416;
+    const int DEFAULT_NUM_CLASSES = 80;
+    const int DEFAULT_INPUT_SIZE = 416;
     const int INPUT_CHANNELS = 3;
+    // Input dimensions must be a multiple of the largest stride
+    const int INPUT_SIZE_ALIGNMENT = 32;
+    // Minimum intersection over smaller box area to merge boxes split across tiles
+    const float TILE_MERGE_THRESHOLD = 0.6f;
+
+    // Input dimensions (selectable for models with dynamic input shapes)
+    int input_height;
+    int input_width;
+
+    // Tiling information (a single tile covers the whole image)
+    int tile_rows;
+    int tile_cols;
+    float tile_overlap;
 
-    // Original image information
-    int org_image_w;
-    int org_image_h;
-    cv::Mat org_image;
-    cv::Mat padded_image;
-    float resize_ratio;
-    float dw;
-    float dh;
-    bool is_rgb;
-        
-    std::vector<cv::Scalar> class_colors;
-    
     std::vector<float> anchors;
-    std::vector<float> strides;
     std::vector<float> xyscale;
 
-    // NOTE: std::list is used here over std::vector for random index deletion
-    // See YOLOv4::Nms function
-    std::vector<std::list<std::unique_ptr<BoundingBox>>> class_boxes;
-    std::vector<std::unique_ptr<BoundingBox>> filtered_boxes;
+    // Output information (from the model's output shapes)
+    int num_classes;
+    YOLOFeatureLayout output_layout;
 
-    void LoadClassColors();
-    void PadImage(cv::Mat const& image);
-    std::pair<int, float> FindMaxClass(float const *layer_output, long offset);
-    bool TransformCoordinates(std::vector<float>& coords, int layer, int row, int col, int anchor);
-    void GetBoundingBoxes(std::vector<Ort::Value> const& model_output, float threshold);
+    void ComputeTiles(YOLOv4Context& ctx);
+    void PadImage(cv::Mat const& image, ImageTile& tile, cv::Mat& canvas);
+    void SetOriginalImage(YOLOv4Context& ctx, uint8_t *const data, int width, int height, bool is_rgb);
+    cv::Mat& GetCanvas(YOLOv4Context& ctx);
+    void PreprocessTile(YOLOv4Context& ctx, ImageTile& tile, cv::Mat& canvas);
+    template <typename T>
+    void GetLayerBoundingBoxes(YOLOv4Context& ctx, T const *layer_output, std::vector<int64_t> const& layer_shape, size_t batch_index, size_t layer, float threshold);
     float BboxIOU(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2);
-    void Nms(float threshold);
-    void WriteBoundingBoxes(std::vector<std::string> const& class_names);
+    float BboxIOS(std::unique_ptr<BoundingBox> const& bbox1, std::unique_ptr<BoundingBox> const& bbox2);
+
+  protected:
+    // Postprocessing steps and the state they depend on, accessible to
+    // subclasses so that each step can be timed on its own
+    const int ANCHORS_PER_CELL = 3;
+    std::vector<float> strides;
+    std::unique_ptr<YOLODecoderBase> decoder;
+    void GetBoundingBoxes(YOLOv4Context& ctx, std::vector<Ort::Value> const& model_output, size_t batch_index, float threshold);
+    void Nms(YOLOv4Context& ctx, float threshold);
+    void WriteDetections(YOLOv4Context& ctx, std::vector<Detection>& detections);
 
   public:
     YOLOv4();
     ~YOLOv4() = default;
     size_t GetNumClasses();
     size_t GetInputTensorSize();
-    void Preprocess(uint8_t *const data, std::vector<float>& input_tensor_values, int width, int height, bool is_rgb);
-    void Postprocess(std::vector<Ort::Value> const& model_output, std::vector<std::string> const& class_labels, float score_threshold, float nms_threshold);
+    size_t GetBatchSize();
+    int GetInputWidth();
+    int GetInputHeight();
+    bool IsChannelsLast();
+    bool SetInputSize(int width, int height);
+    bool SetOutputShapes(std::vector<std::vector<int64_t>> const& output_dims);
+    void SetTiling(int rows, int cols, float overlap);
+    std::unique_ptr<ModelContext> CreateContext();
+    void Preprocess(ModelContext& context, uint8_t *const data, float *input_tensor_values, int width, int height, bool is_rgb);
+    void Preprocess(ModelContext& context, uint8_t *const data, uint8_t *input_tensor_values, int width, int height, bool is_rgb);
+    void Preprocess(ModelContext& context, uint8_t *const data, Ort::Float16_t *input_tensor_values, int width, int height, bool is_rgb);
+    void Postprocess(ModelContext& context, std::vector<Ort::Value> const& model_output, size_t batch_index, float score_threshold, float nms_threshold, std::vector<Detection>& detections);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,408 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "yolov8.h"
+
+/**
+ * @brief Construct a new YOLOv8 object.
+ */
+YOLOv8::YOLOv8() {
+  input_width = DEFAULT_INPUT_SIZE;
+  input_height = DEFAULT_INPUT_SIZE;
+  num_classes = DEFAULT_NUM_CLASSES;
+  boxes_major = false;
+}
+
+size_t YOLOv8::GetNumClasses() {
+  return num_classes;
+}
+
+// Size of a single image within the input tensor
+size_t YOLOv8::GetInputTensorSize() {
+  return input_height * input_width * INPUT_CHANNELS;
+}
+
+// One image per frame
+size_t YOLOv8::GetBatchSize() {
+  return 1;
+}
+
+int YOLOv8::GetInputWidth() {
+  return input_width;
+}
+
+int YOLOv8::GetInputHeight() {
+  return input_height;
+}
+
+// YOLOv8 takes NCHW input
+bool YOLOv8::IsChannelsLast() {
+  return false;
+}
+
+/**
+ * @brief Sets model input dimensions. Must not be called while frames are
+ * being processed.
+ * 
+ * @param width input width.
+ * @param height input height.
+ * @return true if dimensions are valid for YOLOv8.
+ * @return false if dimensions are not a positive multiple of the largest stride.
+ */
+bool YOLOv8::SetInputSize(int width, int height) {
+  if (width <= 0 || height <= 0 || width % INPUT_SIZE_ALIGNMENT != 0 || height % INPUT_SIZE_ALIGNMENT != 0) {
+    GST_ERROR ("Invalid YOLOv8 input size %dx%d, dimensions must be a multiple of %d!", width, height, INPUT_SIZE_ALIGNMENT);
+    return false;
+  }
+  input_width = width;
+  input_height = height;
+  return true;
+}
+
+/**
+ * @brief Derives the class count from the model's output shape, which is
+ * {batch, 4 + classes, boxes}. Exports transposed to {batch, boxes, 4 + classes}
+ * are recognized by having more boxes than features. A dynamic feature axis
+ * leaves the default of 80 classes.
+ * 
+ * @param output_dims shape of each output.
+ * @return true if the shape is a valid YOLOv8 output.
+ * @return false otherwise.
+ */
+bool YOLOv8::SetOutputShapes(std::vector<std::vector<int64_t>> const& output_dims) {
+  if (output_dims.size() != 1 || output_dims[0].size() != 3) {
+    GST_ERROR ("Expected a single 3D YOLOv8 output, got %zu outputs!", output_dims.size());
+    return false;
+  }
+  int64_t features = output_dims[0][1];
+  int64_t boxes = output_dims[0][2];
+  boxes_major = features != -1 && boxes != -1 && features > boxes;
+  if (boxes_major) {
+    std::swap(features, boxes);
+  }
+  if (features != -1 && features <= 4) {
+    GST_ERROR ("Unexpected number of features %" G_GINT64_FORMAT " in YOLOv8 output!", features);
+    return false;
+  }
+  num_classes = features == -1 ? DEFAULT_NUM_CLASSES : (int) (features - 4);
+  return true;
+}
+
+// Tiled inference is not supported; frames are always letterboxed whole
+void YOLOv8::SetTiling(int rows, int cols, float overlap) {
+  if (rows > 1 || cols > 1) {
+    GST_WARNING ("YOLOv8 does not support tiled inference, ignoring %dx%d tiles!", cols, rows);
+  }
+}
+
+/**
+ * @return std::unique_ptr<ModelContext> new, empty YOLOv8 context.
+ */
+std::unique_ptr<ModelContext> YOLOv8::CreateContext() {
+  return std::unique_ptr<ModelContext>(new YOLOv8Context());
+}
+
+/**
+ * @brief Letterboxes image into the context's canvas: resizes it to fit model
+ * input dimensions preserving aspect ratio, centered and padded with grey
+ * (114, 114, 114) pixels, in RGB ordering.
+ * 
+ * @param ctx context to store letterboxed image and its transform in.
+ * @param data image data.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ */
+void YOLOv8::Letterbox(YOLOv8Context& ctx, uint8_t *const data, int width, int height, bool is_rgb) {
+  ctx.org_image_w = width;
+  ctx.org_image_h = height;
+  // Wrap original image (does not copy data)
+  cv::Mat image(height, width, CV_8UC3, data);
+  float resize_ratio = std::min(input_width / (width * 1.0f), input_height / (height * 1.0f));
+  int nw = std::min((int) std::round(width * resize_ratio), input_width);
+  int nh = std::min((int) std::round(height * resize_ratio), input_height);
+  int left = (input_width - nw) / 2;
+  int top = (input_height - nh) / 2;
+  ctx.letterbox.roi = cv::Rect(0, 0, width, height);
+  ctx.letterbox.resize_ratio = resize_ratio;
+  ctx.letterbox.dw = left;
+  ctx.letterbox.dh = top;
+  if (ctx.padded_image.rows != input_height || ctx.padded_image.cols != input_width) {
+    ctx.padded_image = cv::Mat(input_height, input_width, CV_8UC3);
+  }
+  ctx.padded_image = cv::Scalar::all(PAD_VALUE);
+  cv::resize(image, ctx.padded_image(cv::Rect(left, top, nw, nh)), cv::Size(nw, nh));
+  // Change from BGR to RGB ordering if needed
+  if (!is_rgb) {
+    cv::cvtColor(ctx.padded_image, ctx.padded_image, cv::COLOR_BGR2RGB);
+  }
+}
+
+/**
+ * @brief Writes the letterboxed image as NCHW planes into the input tensor.
+ * The image is split into 8-bit planes first, so that conversion reads and
+ * writes contiguous memory (both vectorized by OpenCV).
+ * 
+ * @param ctx context holding the letterboxed image.
+ * @param input_tensor_values out-param to store preprocessed tensor values.
+ * @param type OpenCV type of tensor values; 8-bit values are not scaled.
+ */
+template <typename T>
+void YOLOv8::WritePlanes(YOLOv8Context& ctx, T *input_tensor_values, int type) {
+  size_t plane_size = input_height * input_width;
+  if (type == CV_8UC1) {
+    // Split directly into the tensor (no copy beyond the split itself)
+    for (int c = 0; c < INPUT_CHANNELS; c++) {
+      ctx.planes[c] = cv::Mat(input_height, input_width, type, input_tensor_values + c * plane_size);
+    }
+    cv::split(ctx.padded_image, ctx.planes);
+    return;
+  }
+  cv::split(ctx.padded_image, ctx.planes);
+  for (int c = 0; c < INPUT_CHANNELS; c++) {
+    cv::Mat plane(input_height, input_width, type, input_tensor_values + c * plane_size);
+    ctx.planes[c].convertTo(plane, type, 1.0 / 255.0);
+  }
+}
+
+/**
+ * @brief Preprocesses input data to comply with specifications of YOLOv8.
+ * 
+ * @param context YOLOv8 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ */
+void YOLOv8::Preprocess(ModelContext& context, uint8_t *const data, float *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv8Context& ctx = static_cast<YOLOv8Context&>(context);
+  Letterbox(ctx, data, width, height, is_rgb);
+  WritePlanes(ctx, input_tensor_values, CV_32FC1);
+}
+
+/**
+ * @brief Preprocesses input data for models taking float16 input.
+ * 
+ * @param context YOLOv8 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ */
+void YOLOv8::Preprocess(ModelContext& context, uint8_t *const data, Ort::Float16_t *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv8Context& ctx = static_cast<YOLOv8Context&>(context);
+  Letterbox(ctx, data, width, height, is_rgb);
+  WritePlanes(ctx, input_tensor_values, CV_16FC1);
+}
+
+/**
+ * @brief Preprocesses input data for models taking uint8 input (e.g. INT8 quantized models).
+ * 
+ * @param context YOLOv8 context for this frame.
+ * @param data data to process.
+ * @param input_tensor_values out-param to store preprocessed tensor values, pointing at this frame's batch entry.
+ * @param width image width.
+ * @param height image height.
+ * @param is_rgb is image RGB or BGR format.
+ */
+void YOLOv8::Preprocess(ModelContext& context, uint8_t *const data, uint8_t *input_tensor_values, int width, int height, bool is_rgb) {
+  YOLOv8Context& ctx = static_cast<YOLOv8Context&>(context);
+  Letterbox(ctx, data, width, height, is_rgb);
+  WritePlanes(ctx, input_tensor_values, CV_8UC1);
+}
+
+/**
+ * @brief Extracts boxes scoring at least threshold from one frame's output, in
+ * original image coordinates. In the default {4 + classes, boxes} layout each
+ * class is a row of scores of all boxes; the best class of every box is found
+ * by scanning rows in order, so memory is read sequentially (and the loop
+ * vectorizes), rather than with a stride of the number of boxes per class.
+ * 
+ * @param ctx YOLOv8 context for this frame.
+ * @param output this frame's output values.
+ * @param num_boxes number of candidate boxes in the output.
+ * @param threshold threshold to filter boxes based on score.
+ */
+template <typename T>
+void YOLOv8::GetBoundingBoxes(YOLOv8Context& ctx, T const *output, int64_t num_boxes, float threshold) {
+  long features = 4 + num_classes;
+  // Distance between consecutive boxes, and consecutive features of a box
+  long box_stride = boxes_major ? features : 1;
+  long feature_stride = boxes_major ? 1 : num_boxes;
+  ctx.best_scores.resize(num_boxes);
+  ctx.best_classes.resize(num_boxes);
+  float *best_scores = ctx.best_scores.data();
+  int *best_classes = ctx.best_classes.data();
+  if (boxes_major) {
+    for (int64_t i = 0; i < num_boxes; i++) {
+      T const *scores = output + i * box_stride + 4;
+      int best_class = 0;
+      float best_score = (float) scores[0];
+      for (int c = 1; c < num_classes; c++) {
+        float score = (float) scores[c];
+        if (score > best_score) {
+          best_class = c;
+          best_score = score;
+        }
+      }
+      best_scores[i] = best_score;
+      best_classes[i] = best_class;
+    }
+  } else {
+    T const *row = output + 4 * feature_stride;
+    for (int64_t i = 0; i < num_boxes; i++) {
+      best_scores[i] = (float) row[i];
+      best_classes[i] = 0;
+    }
+    for (int c = 1; c < num_classes; c++) {
+      row += feature_stride;
+      for (int64_t i = 0; i < num_boxes; i++) {
+        float score = (float) row[i];
+        best_classes[i] = score > best_scores[i] ? c : best_classes[i];
+        best_scores[i] = score > best_scores[i] ? score : best_scores[i];
+      }
+    }
+  }
+  ImageTile const& letterbox = ctx.letterbox;
+  float max_x = ctx.org_image_w;
+  float max_y = ctx.org_image_h;
+  for (int64_t i = 0; i < num_boxes; i++) {
+    if (best_scores[i] < threshold) {
+      continue;
+    }
+    T const *box = output + i * box_stride;
+    float cx = (float) box[0];
+    float cy = (float) box[feature_stride];
+    float w = (float) box[2 * feature_stride];
+    float h = (float) box[3 * feature_stride];
+    // Convert (cx, cy, w, h) => (xmin, ymin, xmax, ymax), relative to original image and clipped to it
+    float xmin = std::min(std::max((cx - w * 0.5f - letterbox.dw) / letterbox.resize_ratio, 0.0f), max_x);
+    float ymin = std::min(std::max((cy - h * 0.5f - letterbox.dh) / letterbox.resize_ratio, 0.0f), max_y);
+    float xmax = std::min(std::max((cx + w * 0.5f - letterbox.dw) / letterbox.resize_ratio, 0.0f), max_x);
+    float ymax = std::min(std::max((cy + h * 0.5f - letterbox.dh) / letterbox.resize_ratio, 0.0f), max_y);
+    // Disregard boxes with invalid size/area
+    if (xmax <= xmin || ymax <= ymin) {
+      continue;
+    }
+    ctx.candidates.emplace_back(xmin, ymin, xmax, ymax, best_scores[i], best_classes[i]);
+  }
+}
+
+// Calculate the intersection over union (IOU) of two bounding boxes.
+static float BoxIOU(BoundingBox const& bbox1, BoundingBox const& bbox2) {
+  float left = std::max(bbox1.xmin, bbox2.xmin);
+  float right = std::min(bbox1.xmax, bbox2.xmax);
+  float top = std::max(bbox1.ymin, bbox2.ymin);
+  float bottom = std::min(bbox1.ymax, bbox2.ymax);
+  if (left > right || top > bottom) {
+    return 0;
+  }
+  float intersection = (right - left) * (bottom - top);
+  float area1 = (bbox1.xmax - bbox1.xmin) * (bbox1.ymax - bbox1.ymin);
+  float area2 = (bbox2.xmax - bbox2.xmin) * (bbox2.ymax - bbox2.ymin);
+  return intersection / (area1 + area2 - intersection);
+}
+
+/**
+ * @brief Performs non-maximal suppression per class on the context's
+ * candidates. Candidates are sorted by class and descending score, and each is
+ * kept unless it overlaps a kept box of its class by more than threshold.
+ * Stores kept boxes in the context.
+ * 
+ * @param ctx YOLOv8 context for this frame.
+ * @param threshold IOU threshold for nms.
+ */
+void YOLOv8::Nms(YOLOv8Context& ctx, float threshold) {
+  std::vector<BoundingBox>& candidates = ctx.candidates;
+  std::vector<BoundingBox>& filtered_boxes = ctx.filtered_boxes;
+  std::sort(candidates.begin(), candidates.end(), [](BoundingBox const& a, BoundingBox const& b) {
+    return a.class_index != b.class_index ? a.class_index < b.class_index : a.score > b.score;
+  });
+  filtered_boxes.clear();
+  int current_class = -1;
+  size_t class_start = 0;
+  for (BoundingBox const& candidate : candidates) {
+    if (candidate.class_index != current_class) {
+      current_class = candidate.class_index;
+      class_start = filtered_boxes.size();
+    }
+    bool keep = true;
+    for (size_t i = class_start; i < filtered_boxes.size() && keep; i++) {
+      keep = BoxIOU(filtered_boxes[i], candidate) <= threshold;
+    }
+    if (keep) {
+      filtered_boxes.push_back(candidate);
+    }
+  }
+  candidates.clear();
+}
+
+/**
+ * @brief Postprocess ORT model output with YOLOv8 bounding box information.
+ * Filtered bounding boxes are returned as detections in original image
+ * coordinates, using the letterbox transform stored in the context by Preprocess.
+ * 
+ * @param context YOLOv8 context passed to Preprocess for this frame.
+ * @param model_output ORT output.
+ * @param batch_index index of this frame in the output batch.
+ * @param score_threshold threshold for bounding box scores.
+ * @param nms_threshold threshold for computing non-maximal suppression.
+ * @param detections out-param to append detections to.
+ */
+void YOLOv8::Postprocess(ModelContext& context, std::vector<Ort::Value> const& model_output, size_t batch_index, float score_threshold, float nms_threshold, std::vector<Detection>& detections) {
+  YOLOv8Context& ctx = static_cast<YOLOv8Context&>(context);
+  if (model_output.size() != 1) {
+    GST_ERROR ("Expected a single YOLOv8 output, got %zu!", model_output.size());
+    return;
+  }
+  auto type_info = model_output[0].GetTensorTypeAndShapeInfo();
+  auto shape = type_info.GetShape();
+  if (shape.size() != 3 || (size_t) shape[0] <= batch_index) {
+    GST_ERROR ("Output is missing frame at batch index %zu!", batch_index);
+    return;
+  }
+  int64_t features = boxes_major ? shape[2] : shape[1];
+  int64_t num_boxes = boxes_major ? shape[1] : shape[2];
+  if (features != 4 + num_classes) {
+    GST_ERROR ("Unexpected number of features %" G_GINT64_FORMAT " in YOLOv8 output with %d classes!", features, num_classes);
+    return;
+  }
+  size_t entry_size = features * num_boxes;
+  ctx.candidates.clear();
+  switch (type_info.GetElementType()) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+      GetBoundingBoxes(ctx, model_output[0].GetTensorData<float>() + batch_index * entry_size, num_boxes, score_threshold);
+      break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+      // Ort::Float16_t and cv::float16_t share the IEEE half-precision layout
+      GetBoundingBoxes(ctx, reinterpret_cast<cv::float16_t const*>(model_output[0].GetTensorData<Ort::Float16_t>()) + batch_index * entry_size, num_boxes, score_threshold);
+      break;
+    default:
+      GST_ERROR ("Unsupported output element type %d!", type_info.GetElementType());
+      return;
+  }
+  Nms(ctx, nms_threshold);
+  for (BoundingBox const& bbox : ctx.filtered_boxes) {
+    detections.push_back(Detection{bbox.xmin, bbox.ymin, bbox.xmax, bbox.ymax, bbox.score, bbox.class_index});
+  }
+}
@@ -0,0 +1,102 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __YOLOV8_H__
+#define __YOLOV8_H__
+
+#include <opencv2/opencv.hpp>
+#include "objectdetectionmodel.h"
+#include "yolodecoder.h"
+
+// Per-frame YOLOv8 state (see ModelContext)
+struct YOLOv8Context : public ModelContext {
+  // Original image information
+  int org_image_w = 0;
+  int org_image_h = 0;
+  // Resize ratio and padding of the letterboxed image (roi covers the whole image)
+  ImageTile letterbox;
+  // Letterboxed image, in RGB ordering, and its channel planes (act as caches)
+  cv::Mat padded_image;
+  cv::Mat planes[3];
+
+  // Best class and its score of each candidate box
+  std::vector<float> best_scores;
+  std::vector<int> best_classes;
+  // Boxes passing the score threshold, then those kept by NMS
+  std::vector<BoundingBox> candidates;
+  std::vector<BoundingBox> filtered_boxes;
+};
+
+/**
+ * @brief Anchor-free YOLO object detection model (YOLOv8 and later exports).
+ * Takes letterboxed NCHW RGB input and has a single {batch, 4 + classes,
+ * boxes} output of (center x, center y, width, height) in input pixels
+ * followed by per-class scores. Per-frame state lives in a YOLOv8Context, so
+ * one instance may serve several threads as long as its configuration is not
+ * changed meanwhile.
+ */
+class YOLOv8 : public ObjectDetectionModel {
+  private:
+    // Model information
+    const int DEFAULT_NUM_CLASSES = 80;
+    const int DEFAULT_INPUT_SIZE = 640;
+    const int INPUT_CHANNELS = 3;
+    // Input dimensions must be a multiple of the largest stride
+    const int INPUT_SIZE_ALIGNMENT = 32;
+    // Letterbox padding value
+    const int PAD_VALUE = 114;
+
+    // Input dimensions (selectable for models with dynamic input shapes)
+    int input_height;
+    int input_width;
+
+    // Output information (from the model's output shape)
+    int num_classes;
+    // Whether output is {batch, boxes, 4 + classes} rather than {batch, 4 + classes, boxes}
+    bool boxes_major;
+
+    void Letterbox(YOLOv8Context& ctx, uint8_t *const data, int width, int height, bool is_rgb);
+    template <typename T>
+    void WritePlanes(YOLOv8Context& ctx, T *input_tensor_values, int type);
+    template <typename T>
+    void GetBoundingBoxes(YOLOv8Context& ctx, T const *output, int64_t num_boxes, float threshold);
+    void Nms(YOLOv8Context& ctx, float threshold);
+
+  public:
+    YOLOv8();
+    ~YOLOv8() = default;
+    size_t GetNumClasses();
+    size_t GetInputTensorSize();
+    size_t GetBatchSize();
+    int GetInputWidth();
+    int GetInputHeight();
+    bool IsChannelsLast();
+    bool SetInputSize(int width, int height);
+    bool SetOutputShapes(std::vector<std::vector<int64_t>> const& output_dims);
+    void SetTiling(int rows, int cols, float overlap);
+    std::unique_ptr<ModelContext> CreateContext();
+    void Preprocess(ModelContext& context, uint8_t *const data, float *input_tensor_values, int width, int height, bool is_rgb);
+    void Preprocess(ModelContext& context, uint8_t *const data, uint8_t *input_tensor_values, int width, int height, bool is_rgb);
+    void Preprocess(ModelContext& context, uint8_t *const data, Ort::Float16_t *input_tensor_values, int width, int height, bool is_rgb);
+    void Postprocess(ModelContext& context, std::vector<Ort::Value> const& model_output, size_t batch_index, float score_threshold, float nms_threshold, std::vector<Detection>& detections);
+};
+
+#endif
@@ -1,5 +1,8 @@
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 /* Structure to contain all our information, so we can pass it to callbacks */
 typedef struct _PipelineData {
@@ -134,8 +137,9 @@ bus_call (GstBus *bus, GstMessage *msg, gpointer data)
   return TRUE;
 }
 
+/* Run detector over test video in given format, through ort-daemon if daemon_socket is set */
 void
-test_supported_format (GstCaps *caps)
+test_supported_format (GstCaps *caps, const gchar *daemon_socket)
 {
   PipelineData data;
   GstStateChangeReturn ret;
@@ -163,7 +167,7 @@ test_supported_format (GstCaps *caps)
   data.capsfilter = gst_element_factory_make ("capsfilter", "capsfilter");
   data.object_detector = gst_element_factory_make ("ortobjectdetector", "ortobjectdetector");
   data.convert2 = gst_element_factory_make ("videoconvert", "audioconvert2");
-  data.sink = gst_element_factory_make ("autovideosink", "videosink");
+  data.sink = gst_element_factory_make ("fakesink", "videosink");
 
   if (!data.qtdemux || !data.decodebin || !data.sink || !data.filesrc) {
     ck_abort_msg ("Decodebin or qtdemux or filesrc or output could not be found - check your install\n");
@@ -182,6 +186,9 @@ test_supported_format (GstCaps *caps)
   g_object_set (G_OBJECT (data.object_detector), "label-file", "../../assets/models/yolov4/labels.txt", NULL);
 
   g_object_set (G_OBJECT (data.capsfilter), "caps", caps, NULL);
+  if (daemon_socket) {
+    g_object_set (G_OBJECT (data.object_detector), "daemon-socket", daemon_socket, NULL);
+  }
 
   // SET OTHER PROPS IF NEEDED FOR VARIOUS TESTS
 
@@ -222,6 +229,12 @@ test_supported_format (GstCaps *caps)
   g_timeout_add_seconds(3, g_main_loop_quit, loop);
   g_main_loop_run (loop);
 
+  if (daemon_socket) {
+    guint64 frames_served;
+    g_object_get (G_OBJECT (data.object_detector), "frames-served", &frames_served, NULL);
+    ck_assert_msg (frames_served > 0, "No frames were inferenced through ort-daemon");
+  }
+
   /* clean up */
   gst_element_set_state (data.pipeline, GST_STATE_NULL);
   gst_object_unref (data.pipeline);
@@ -229,15 +242,169 @@ test_supported_format (GstCaps *caps)
   g_main_loop_unref (loop);
 }
 
+/* Pipeline variant measured by the performance test */
+typedef struct _PerfVariant {
+  const gchar *name;
+  const gchar *format;
+  /* Extra ortobjectdetector properties, in gst-launch syntax */
+  const gchar *properties;
+} PerfVariant;
+
+static const PerfVariant perf_variants[] = {
+  {"rgb", "RGB", ""},
+  {"bgr", "BGR", ""},
+  {"rgb enable-all", "RGB", "optimization-level=enable-all"},
+  {"rgb interval=2", "RGB", "inference-interval=2"},
+};
+
+/* Minimum fps each variant must sustain, from ORT_PERF_MIN_FPS (the
+ * Performance case only runs when it is set) */
+static gdouble
+perf_min_fps (void)
+{
+  return g_ascii_strtod (g_getenv ("ORT_PERF_MIN_FPS"), NULL);
+}
+
+/* Get a stage statistic (in milliseconds) from the detector's stats structure */
+static gdouble
+perf_stat (const GstStructure *stats, const gchar *field)
+{
+  gdouble value = 0;
+
+  gst_structure_get_double (stats, field, &value);
+  return value;
+}
+
+/* Run whole test video through detector as fast as possible, returning achieved fps */
+static gdouble
+run_perf_variant (const PerfVariant *variant)
+{
+  GstElement *pipeline, *detector;
+  GstStructure *stats = NULL;
+  GError *err = NULL;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *description;
+  gint64 start, elapsed;
+  guint64 frames;
+  gdouble fps;
+
+  description = g_strdup_printf ("filesrc location=../../assets/videos/car_video.mp4 ! decodebin ! "
+      "videoconvert ! video/x-raw,format=%s ! "
+      "ortobjectdetector name=detector model-file=../../assets/models/yolov4/yolov4.onnx "
+      "label-file=../../assets/models/yolov4/labels.txt %s ! fakesink sync=false",
+      variant->format, variant->properties);
+  pipeline = gst_parse_launch (description, &err);
+  g_free (description);
+  if (!pipeline) {
+    ck_abort_msg ("Unable to create pipeline: %s\n", err->message);
+  }
+  detector = gst_bin_get_by_name (GST_BIN (pipeline), "detector");
+
+  /* Model is loaded during the state change, before timing starts */
+  ck_assert_msg (gst_element_set_state (pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "Failed to start up pipeline!\n");
+  start = g_get_monotonic_time ();
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = g_get_monotonic_time () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    ck_abort_msg ("Error in variant '%s': %s\n", variant->name, err->message);
+  }
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  g_object_get (G_OBJECT (detector), "frames", &frames, "stats", &stats, NULL);
+  fps = elapsed > 0 ? frames * 1e6 / elapsed : 0;
+  g_print ("%-16s %8" G_GUINT64_FORMAT " %8.2f %8.2f %8.2f %8.2f %8.2f\n", variant->name, frames, fps,
+      perf_stat (stats, "run-p50"), perf_stat (stats, "total-p50"),
+      perf_stat (stats, "total-p95"), perf_stat (stats, "total-p99"));
+  ck_assert_msg (frames > 0, "No frames were processed in variant '%s'", variant->name);
+
+  gst_structure_free (stats);
+  gst_object_unref (detector);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  return fps;
+}
+
+/* Start ort-daemon (built alongside this test), returning once it listens on socket_path */
+static GPid
+start_daemon (const gchar *socket_path)
+{
+  gchar *argv[] = {(gchar *) "./ort-daemon", (gchar *) socket_path,
+      (gchar *) "../../assets/models/yolov4/yolov4.onnx",
+      (gchar *) "../../assets/models/yolov4/labels.txt", NULL};
+  GError *err = NULL;
+  GPid pid;
+  gint i;
+
+  if (!g_spawn_async (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &pid, &err)) {
+    ck_abort_msg ("Unable to start ort-daemon: %s\n", err->message);
+  }
+  /* Socket is created once the model is loaded */
+  for (i = 0; i < 300 && !g_file_test (socket_path, G_FILE_TEST_EXISTS); i++) {
+    g_usleep (100 * 1000);
+  }
+  ck_assert_msg (g_file_test (socket_path, G_FILE_TEST_EXISTS), "ort-daemon did not start listening\n");
+  return pid;
+}
+
+static void
+stop_daemon (GPid pid)
+{
+  gint status;
+
+  kill (pid, SIGTERM);
+  waitpid (pid, &status, 0);
+  g_spawn_close_pid (pid);
+  ck_assert_msg (WIFEXITED (status) && WEXITSTATUS (status) == 0, "ort-daemon did not exit cleanly\n");
+}
+
 GST_START_TEST(test_supported_format_video_rgb)
 {
-  test_supported_format(gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "RGB", NULL));
+  test_supported_format(gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "RGB", NULL), NULL);
 }
 GST_END_TEST;
 
 GST_START_TEST(test_supported_format_video_bgr)
 {
-  test_supported_format(gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "BGR", NULL));
+  test_supported_format(gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "BGR", NULL), NULL);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_daemon_video_rgb)
+{
+  gchar *dir = g_dir_make_tmp ("ortdaemon-XXXXXX", NULL);
+  gchar *socket_path = g_build_filename (dir, "ort.sock", NULL);
+  GPid pid = start_daemon (socket_path);
+
+  test_supported_format(gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "RGB", NULL), socket_path);
+
+  stop_daemon (pid);
+  ck_assert_msg (!g_file_test (socket_path, G_FILE_TEST_EXISTS), "ort-daemon did not remove its socket\n");
+  g_rmdir (dir);
+  g_free (socket_path);
+  g_free (dir);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_pipeline_throughput)
+{
+  gdouble min_fps = perf_min_fps ();
+  gdouble fps[G_N_ELEMENTS (perf_variants)];
+  guint i;
+
+  gst_init (NULL, NULL);
+  g_print ("%-16s %8s %8s %8s %8s %8s %8s\n", "variant", "frames", "fps", "run-p50", "p50", "p95", "p99");
+  for (i = 0; i < G_N_ELEMENTS (perf_variants); i++) {
+    fps[i] = run_perf_variant (&perf_variants[i]);
+  }
+  for (i = 0; i < G_N_ELEMENTS (perf_variants); i++) {
+    ck_assert_msg (fps[i] >= min_fps, "Variant '%s' achieved %.2f fps, below the floor of %.2f fps",
+        perf_variants[i].name, fps[i], min_fps);
+  }
 }
 GST_END_TEST;
 
@@ -264,7 +431,21 @@ Suite *gst_ortobjectdetector_suite(void) {
   tcase_add_test(supported_formats, test_supported_format_video_rgb);
   tcase_add_test(supported_formats, test_supported_format_video_bgr);
 
+  /* Allow for the daemon loading its model */
+  TCase *daemon_case = tcase_create("Daemon");
+  tcase_set_timeout(daemon_case, timeout * 6);
+  tcase_add_test(daemon_case, test_daemon_video_rgb);
+
   suite_add_tcase(s, supported_formats);
+  suite_add_tcase(s, daemon_case);
+
+  /* Whole video, once per variant; opt in by setting ORT_PERF_MIN_FPS */
+  if (g_getenv ("ORT_PERF_MIN_FPS")) {
+    TCase *performance_case = tcase_create("Performance");
+    tcase_set_timeout(performance_case, timeout * 60);
+    tcase_add_test(performance_case, test_pipeline_throughput);
+    suite_add_tcase(s, performance_case);
+  }
   return s;
 }
 
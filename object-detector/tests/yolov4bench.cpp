@@ -0,0 +1,322 @@
+/*
+ * GStreamer
+ * Copyright (C) 2006 Stefan Kost <ensonic@users.sf.net>
+ * Copyright (C) 2022  <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Microbenchmarks of YOLOv4 pre/postprocessing. Postprocessing runs on
+ * synthetic output tensors with a controlled density of candidate boxes, so
+ * neither a model file nor an ORT session is needed.
+ *
+ * Usage: yolov4-bench [--filter <substring>] [--min-time <seconds>] [--output <file>]
+ * Results are written as JSON (to stdout by default). Run with
+ * `meson test --benchmark`.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "src/yolov4.h"
+
+// Score threshold the candidate densities are relative to
+#define BENCH_SCORE_THRESHOLD 0.25f
+#define BENCH_NMS_THRESHOLD 0.213f
+
+// Timing of one benchmark, in microseconds per iteration
+struct BenchResult {
+  std::string name;
+  size_t iterations;
+  double mean_us;
+  double median_us;
+  double p95_us;
+  double min_us;
+};
+
+// Runs benchmarks and collects their results
+class BenchRunner {
+  private:
+    std::string filter;
+    double min_time_s;
+    std::vector<BenchResult> results;
+
+  public:
+    BenchRunner(std::string const& filter, double min_time_s) : filter(filter), min_time_s(min_time_s) {}
+
+    /**
+     * @brief Times body repeatedly (after a few warm-up iterations) until
+     * min_time_s has been spent in it. setup runs before each iteration and is
+     * not timed.
+     */
+    void Run(std::string const& name, std::function<void()> setup, std::function<void()> body) {
+      if (name.find(filter) == std::string::npos) {
+        return;
+      }
+      for (int i = 0; i < 3; i++) {
+        setup();
+        body();
+      }
+      std::vector<double> samples;
+      double total_us = 0;
+      while (total_us < min_time_s * 1e6 || samples.size() < 10) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        samples.push_back(us);
+        total_us += us;
+      }
+      std::sort(samples.begin(), samples.end());
+      BenchResult result;
+      result.name = name;
+      result.iterations = samples.size();
+      result.mean_us = total_us / samples.size();
+      result.median_us = samples[samples.size() / 2];
+      result.p95_us = samples[std::min(samples.size() - 1, (size_t) (samples.size() * 0.95))];
+      result.min_us = samples[0];
+      results.push_back(result);
+      std::cerr << name << ": " << result.median_us << " us" << std::endl;
+    }
+
+    std::string ToJson() {
+      std::ostringstream json;
+      json << "{\n  \"context\": {\"onnxruntime\": \"" << OrtGetApiBase()->GetVersionString()
+           << "\", \"opencv\": \"" << CV_VERSION << "\", \"min_time_s\": " << min_time_s << "},\n"
+           << "  \"benchmarks\": [";
+      for (size_t i = 0; i < results.size(); i++) {
+        BenchResult const& result = results[i];
+        json << (i == 0 ? "\n" : ",\n")
+             << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+             << ", \"mean_us\": " << result.mean_us << ", \"median_us\": " << result.median_us
+             << ", \"p95_us\": " << result.p95_us << ", \"min_us\": " << result.min_us << "}";
+      }
+      json << "\n  ]\n}\n";
+      return json.str();
+    }
+};
+
+// YOLOv4 with its postprocessing steps exposed, so each can be timed on its own
+class YOLOv4Stages : public YOLOv4 {
+  public:
+    using YOLOv4::ANCHORS_PER_CELL;
+    using YOLOv4::strides;
+    using YOLOv4::decoder;
+    using YOLOv4::GetBoundingBoxes;
+    using YOLOv4::Nms;
+    using YOLOv4::WriteDetections;
+};
+
+// Benchmarks of YOLOv4 pre/postprocessing
+class YOLOv4Bench {
+  private:
+    BenchRunner& runner;
+    std::mt19937 rng;
+
+    // Random image of the given dimensions
+    cv::Mat CreateImage(int width, int height) {
+      cv::Mat image(height, width, CV_8UC3);
+      cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+      return image;
+    }
+
+    /**
+     * @brief Fills synthetic output layers (NHWC grid of anchors, 5 + classes
+     * features each) such that `density` of all anchors pass the score
+     * threshold. Boxes of neighbouring cells and anchors overlap, so at higher
+     * densities NMS has boxes to suppress, as in real output.
+     */
+    std::vector<Ort::Value> CreateOutput(YOLOv4Stages& model, std::vector<std::vector<float>>& layers, double density) {
+      Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+      std::vector<Ort::Value> output;
+      std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+      std::normal_distribution<float> jitter(0.0f, 0.3f);
+      int num_classes = (int) model.GetNumClasses();
+      int features = 5 + num_classes;
+      layers.resize(model.strides.size());
+      for (size_t layer = 0; layer < model.strides.size(); layer++) {
+        int64_t grid_h = (int64_t) (model.GetInputHeight() / model.strides[layer]);
+        int64_t grid_w = (int64_t) (model.GetInputWidth() / model.strides[layer]);
+        std::vector<int64_t> shape{1, grid_h, grid_w, 3, features};
+        std::vector<float>& values = layers[layer];
+        values.assign(grid_h * grid_w * 3 * features, 0.0f);
+        for (int64_t anchor = 0; anchor < grid_h * grid_w * 3; anchor++) {
+          float *box = values.data() + anchor * features;
+          bool candidate = uniform(rng) < density;
+          box[0] = jitter(rng);
+          box[1] = jitter(rng);
+          box[2] = jitter(rng);
+          box[3] = jitter(rng);
+          box[4] = candidate ? 0.9f : 0.01f;
+          // A few classes per frame, as in real scenes
+          int class_index = (int) (uniform(rng) * 4) * 7;
+          for (int i = 0; i < num_classes; i++) {
+            box[5 + i] = uniform(rng) * 0.05f;
+          }
+          box[5 + class_index] = 0.95f;
+        }
+        output.push_back(Ort::Value::CreateTensor<float>(memory_info, values.data(), values.size(), shape.data(), shape.size()));
+      }
+      return output;
+    }
+
+    void ClearContext(YOLOv4Context& ctx) {
+      for (auto& boxes : ctx.class_boxes) {
+        boxes.clear();
+      }
+      ctx.filtered_boxes.clear();
+    }
+
+  public:
+    YOLOv4Bench(BenchRunner& runner) : runner(runner), rng(42) {}
+
+    void Preprocess() {
+      const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+      YOLOv4 model;
+      std::unique_ptr<ModelContext> ctx = model.CreateContext();
+      std::vector<float> float_tensor(model.GetInputTensorSize());
+      std::vector<uint8_t> uint8_tensor(model.GetInputTensorSize());
+      for (auto const& size : sizes) {
+        cv::Mat image = CreateImage(size[0], size[1]);
+        std::string suffix = std::to_string(size[0]) + "x" + std::to_string(size[1]);
+        runner.Run("preprocess/float/bgr/" + suffix, []() {}, [&]() {
+          model.Preprocess(*ctx, image.data, float_tensor.data(), image.cols, image.rows, false);
+        });
+        runner.Run("preprocess/float/rgb/" + suffix, []() {}, [&]() {
+          model.Preprocess(*ctx, image.data, float_tensor.data(), image.cols, image.rows, true);
+        });
+        runner.Run("preprocess/uint8/rgb/" + suffix, []() {}, [&]() {
+          model.Preprocess(*ctx, image.data, uint8_tensor.data(), image.cols, image.rows, true);
+        });
+      }
+    }
+
+    void Postprocess() {
+      const double densities[] = {0.0001, 0.001, 0.01, 0.05};
+      YOLOv4Stages model;
+      std::unique_ptr<ModelContext> context = model.CreateContext();
+      YOLOv4Context& ctx = static_cast<YOLOv4Context&>(*context);
+      // Tiles (and with them the coordinate transform) come from preprocessing a frame
+      cv::Mat image = CreateImage(1920, 1080);
+      std::vector<float> tensor(model.GetInputTensorSize());
+      model.Preprocess(ctx, image.data, tensor.data(), image.cols, image.rows, true);
+      std::vector<Detection> detections;
+      for (double density : densities) {
+        std::vector<std::vector<float>> layers;
+        std::vector<Ort::Value> output = CreateOutput(model, layers, density);
+        std::ostringstream suffix;
+        suffix << "density=" << density;
+        runner.Run("get-bounding-boxes/" + suffix.str(), [&]() {
+          ClearContext(ctx);
+        }, [&]() {
+          model.GetBoundingBoxes(ctx, output, 0, BENCH_SCORE_THRESHOLD);
+        });
+        // Same decoding without compile-time model constants, for comparison
+        std::unique_ptr<YOLODecoderBase> specialized = std::move(model.decoder);
+        model.decoder.reset(new YOLODecoder<0, 0, YOLOFeatureLayout::CELL_MAJOR>((int) model.GetNumClasses(), model.ANCHORS_PER_CELL));
+        runner.Run("get-bounding-boxes/generic/" + suffix.str(), [&]() {
+          ClearContext(ctx);
+        }, [&]() {
+          model.GetBoundingBoxes(ctx, output, 0, BENCH_SCORE_THRESHOLD);
+        });
+        model.decoder = std::move(specialized);
+        runner.Run("nms/" + suffix.str(), [&]() {
+          ClearContext(ctx);
+          model.GetBoundingBoxes(ctx, output, 0, BENCH_SCORE_THRESHOLD);
+        }, [&]() {
+          model.Nms(ctx, BENCH_NMS_THRESHOLD);
+        });
+        runner.Run("write-detections/" + suffix.str(), [&]() {
+          ClearContext(ctx);
+          model.GetBoundingBoxes(ctx, output, 0, BENCH_SCORE_THRESHOLD);
+          model.Nms(ctx, BENCH_NMS_THRESHOLD);
+          detections.clear();
+        }, [&]() {
+          model.WriteDetections(ctx, detections);
+        });
+        runner.Run("postprocess/" + suffix.str(), [&]() {
+          ClearContext(ctx);
+          detections.clear();
+        }, [&]() {
+          model.Postprocess(ctx, output, 0, BENCH_SCORE_THRESHOLD, BENCH_NMS_THRESHOLD, detections);
+        });
+      }
+      ClearContext(ctx);
+    }
+
+    void Draw() {
+      const size_t counts[] = {10, 100};
+      std::vector<std::string> labels;
+      for (int i = 0; i < 80; i++) {
+        labels.push_back("class" + std::to_string(i));
+      }
+      cv::Mat image = CreateImage(1920, 1080);
+      DetectionFrame frame{image.data, image.cols, image.rows, true};
+      std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+      for (size_t count : counts) {
+        std::vector<Detection> detections;
+        for (size_t i = 0; i < count; i++) {
+          float x = uniform(rng) * 1800, y = uniform(rng) * 960;
+          detections.push_back(Detection{x, y, x + 20 + uniform(rng) * 100, y + 20 + uniform(rng) * 100, uniform(rng), (int) (i % labels.size())});
+        }
+        runner.Run("draw-detections/count=" + std::to_string(count), []() {}, [&]() {
+          DrawDetections(frame, detections, labels);
+        });
+      }
+    }
+};
+
+int main(int argc, char* argv[]) {
+  std::string filter;
+  double min_time_s = 0.5;
+  std::string output_path;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      min_time_s = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else {
+      std::cout << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <seconds>] [--output <file>]" << std::endl;
+      return -1;
+    }
+  }
+  BenchRunner runner(filter, min_time_s);
+  YOLOv4Bench bench(runner);
+  bench.Preprocess();
+  bench.Postprocess();
+  bench.Draw();
+  std::string json = runner.ToJson();
+  if (output_path.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream output(output_path);
+    output << json;
+    if (!output.good()) {
+      std::cerr << "Unable to write " << output_path << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}